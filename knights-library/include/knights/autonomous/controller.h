@@ -3,22 +3,106 @@
 #ifndef _CONTROLLER_H
 #define _CONTROLLER_H
 
+#include "knights/autonomous/exit_condition.h"
 #include "knights/autonomous/pid.h"
 #include "knights/autonomous/ramsete.h"
 #include "knights/autonomous/path.h"
+#include "knights/autonomous/profile.h"
 
 #include "knights/robot/chassis.h"
 
+#include "pros/rtos.hpp"
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// angle from the heading that holonomic movements holding it end within, in radians
+#define HOLONOMIC_HEADING_TOLERANCE 0.05
+// distance from the starting position that holonomic turns hold the robot within, in inches
+#define HOLONOMIC_POSITION_TOLERANCE 1.0
+
 namespace knights {
 
     class RobotController {
         private:
-            PIDController *pid_controller;
-            RamseteConstants *ramsete_constants;
-            RobotChassis *chassis;
+            PIDController *pid_controller = nullptr;
+            PIDController *angular_pid_controller = nullptr; // turns holonomic drivetrains while they translate, a copy of pid_controller if not set
+            RamseteConstants *ramsete_constants = nullptr;
+            RobotChassis *chassis = nullptr;
             bool use_motor_encoders = false;
 
-            bool in_motion = false;
+            std::atomic<bool> in_motion = false; // if a movement is running
+            std::atomic<bool> cancel_requested = false; // if the running movement should stop
+            std::atomic<int> queued_motion = 0; // id of an async movement that has been started but isn't running yet, 0 if none
+            std::atomic<int> cancelled_motion = 0; // id of a queued async movement that was cancelled before it started running
+            int motion_count = 0; // amount of async movements started, used for their ids
+            std::atomic<float> motion_distance = 0.0; // distance the running movement has gone, in inches (degrees for turns)
+            std::atomic<float> motion_progress = 0.0; // fraction of the running movement that is done, from 0 to 1
+            pros::Mutex motion_mutex; // held by the running movement so only one runs at a time
+
+            input::AutonomousInputMap *input_map = nullptr; // runs the functions of route markers
+
+            /**
+             * @brief Run the functions of the markers the robot has passed since the last call
+             * 
+             * @param markers markers of the route being followed
+             * @param fired which markers have already been run, same size as markers
+             * @param distance distance the robot has gone along the route
+             * @param length total length of the route
+             */
+            void fire_markers(const std::vector<RouteMarker> &markers, std::vector<bool> &fired, float distance, float length);
+
+            /**
+             * @brief Run a movement on its own task, once the current movement is done
+             * 
+             * @param motion the movement to run, called with async set to false
+             */
+            void run_async(std::function<void()> motion);
+
+            /**
+             * @brief Start a movement, waiting for the current one to finish first
+             */
+            void start_motion();
+
+            /**
+             * @brief End the running movement
+             */
+            void end_motion();
+
+            /**
+             * @brief Update how far the running movement has gone, for wait_until()
+             * 
+             * @param distance distance the movement has gone, in inches (degrees for turns)
+             * @param progress fraction of the movement that is done, from 0 to 1
+             */
+            void update_progress(float distance, float progress);
+
+            /**
+             * @brief Check if the robot is still outside the end tolerance of a position, or is moving away from it.
+             *  Both positions are from the same odometry update
+             * 
+             * @param desired_position position the movement is going to
+             * @param end_tolerance distance from the position the movement ends at
+             * @return true if the movement should keep going
+             */
+            bool not_arrived(const Pos &desired_position, float end_tolerance);
+
+            /**
+             * @brief Drive a holonomic drivetrain to a pose, translating straight at it and turning at the same time.
+             *  Has to be called from inside a movement, after start_motion()
+             * 
+             * @param target position to drive to, and the heading to end at in radians
+             * @param heading_error angle to turn to reach the target heading in radians, counterclockwise positive - more than half a turn forces the long way
+             * @param end_tolerance distance from the position to end at, in inches
+             * @param angle_tolerance angle from the heading to end at, in radians
+             * @param timeout amount of time to wait before exiting the movement
+             * @param exit_velocity velocity to leave the robot driving at towards the target, in inches per second - 0 to stop
+             * @param exit_condition conditions to end the movement with, on the distance left in inches (the angle left in degrees if
+             *                       the robot only turns) - replace the tolerances when any are turned on
+             */
+            void holonomic_move(const Pos target, float heading_error, float end_tolerance, float angle_tolerance, float timeout,
+                float exit_velocity, knights::ExitCondition exit_condition);
         public:
             /**
              * @brief Construct a new Robot Controller object
@@ -40,7 +124,62 @@ namespace knights {
             RobotController(RobotChassis *chassis, PIDController *pid_controller, bool use_motor_encoders = false);
 
             /**
-             * @brief Follow a route that has been read into the route memory of the robot
+             * @brief Destroy the Robot Controller object, cancelling any movement still running on its own task
+             */
+            ~RobotController();
+
+            /**
+             * @brief Set the PID controller that turns holonomic drivetrains while they translate, so the turning can be tuned on its own.
+             *  Its error is in radians, like turn_to_angle
+             * 
+             * @param angular_pid_controller PID controller for turning, nullptr to use a copy of the main PID controller
+             */
+            void set_angular_pid(PIDController *angular_pid_controller);
+
+            /**
+             * @brief Set the autonomous input map that runs the functions of route markers while following routes
+             * 
+             * @param input_map input map with the marker functions bound to their names, nullptr to not run markers
+             */
+            void set_input_map(input::AutonomousInputMap *input_map);
+
+            /**
+             * @brief Wait for the running movement, and any async movement waiting to run, to finish
+             */
+            void wait_until_done();
+
+            /**
+             * @brief Wait until the running movement has gone a distance, or it finishes
+             * 
+             * @param distance distance to wait for, in inches (degrees for turns)
+             */
+            void wait_until(float distance);
+
+            /**
+             * @brief Wait until a fraction of the running movement is done, or it finishes
+             * 
+             * @param progress fraction of the movement to wait for, from 0 to 1
+             */
+            void wait_until_progress(float progress);
+
+            /**
+             * @brief Stop the running movement early, the robot is left stopped.
+             *  An async movement that hasn't started running yet ends as soon as it starts
+             */
+            void cancel();
+
+            /**
+             * @brief Check if a movement is running or waiting to run
+             * 
+             * @return true if a movement is running or waiting to run
+             */
+            bool is_in_motion();
+
+            /**
+             * @brief Follow a route that has been read into the route memory of the robot.
+             * 
+             *  The route's markers are run through the input map as the robot's projection onto the route passes them.
+             *  They run inside the follow loop, so their functions shouldn't block.
              * 
              * @param route Pointer to the route to follow
              * @param lookahead_distance Distance to look ahead on the route in order to obtain the target position
@@ -48,11 +187,65 @@ namespace knights {
              * @param forwards Whether the bot should follow with its front or back
              * @param end_tolerance Distance to end the loop at
              * @param timeout Amount of time to wait before ending the movement
+             * @param use_pid Whether to slow down at the end of the route with the PID controller
+             * @param exit_velocity Velocity to leave the robot driving at when the route ends, in inches per second - 0 to stop
+             * @param async Whether to run the movement on its own task and return right away - the route has to outlive the movement
+             * @param exit_condition Conditions to end the movement with, on the distance to the end of the route in inches - replace the end tolerance when any are turned on
              */
-            void follow_route_pursuit(knights::Route &route, float lookahead_distance = 15.0, const float max_speed = 127.0, bool forwards = true, float end_tolerance = 8.0, float timeout = 5000, float use_pid = false);
+            void follow_route_pursuit(knights::Route &route, float lookahead_distance = 15.0, const float max_speed = 127.0, bool forwards = true, float end_tolerance = 8.0, float timeout = 5000, float use_pid = false,
+                float exit_velocity = 0.0, bool async = false, knights::ExitCondition exit_condition = knights::ExitCondition());
 
 
-            void move_to_point(const Pos desired_position, const bool forwards = true, const float &end_tolerance = 2.0, float timeout = 1000);
+            /**
+             * @brief Track a time parameterized trajectory with the RAMSETE controller.
+             * 
+             *  The robot drives at the velocities planned in the trajectory, and the RAMSETE feedback law corrects
+             *  for position and heading error. Uses the controller's ramsete constants, or (2.0, 0.7) if none were given.
+             *  If the trajectory ends moving, the robot is left driving at the last timestamp's velocities.
+             *  The wheel speeds are turned into voltages with the drivetrain's feedforward model when one is set.
+             * 
+             * @param trajectory Timestamps to follow, from ProfileGenerator::generate_profile
+             * @param forwards Whether the bot should follow with its front or back
+             * @param timeout Amount of time to wait before ending the movement, if it is longer than the trajectory
+             * @param markers Markers to run through the input map as the trajectory passes them, from the route it was made from
+             * @param async Whether to run the movement on its own task and return right away - the trajectory has to outlive the movement
+             * @param exit_condition Conditions to end the movement with, on the distance to the last timestamp in inches - when any are turned on
+             *                       the robot keeps tracking the last timestamp after the trajectory ends until they are met
+             */
+            void follow_trajectory_ramsete(const std::vector<ProfileTimestamp> &trajectory, bool forwards = true, float timeout = 15000, 
+                const std::vector<RouteMarker> &markers = {}, bool async = false, knights::ExitCondition exit_condition = knights::ExitCondition());
+
+            /**
+             * @brief Drive to a point on the field
+             * 
+             * @param desired_position Position to drive to, the heading is not used
+             * @param forwards Whether the bot should drive with its front or back
+             * @param end_tolerance Distance from the point to end the movement at
+             * @param timeout Amount of time to wait before exiting the movement
+             * @param async Whether to run the movement on its own task and return right away
+             * @param exit_condition Conditions to end the movement with, on the distance to the point in inches - replace the end tolerance when any are turned on
+             */
+            void move_to_point(const Pos desired_position, const bool forwards = true, const float &end_tolerance = 2.0, float timeout = 1000, bool async = false,
+                knights::ExitCondition exit_condition = knights::ExitCondition());
+
+            /**
+             * @brief Drive to a position and arrive facing a heading, in one movement.
+             * 
+             *  The robot steers towards a carrot point behind the target along its heading. The carrot is lead times the distance
+             *  to the target away from it, so it slides onto the target as the robot gets closer and the robot curves in facing the heading.
+             * 
+             * @param desired_pose Position to drive to, and the heading to arrive at in radians
+             * @param forwards Whether the bot should drive with its front or back
+             * @param lead How far behind the target the carrot starts, as a fraction of the distance to the target - 0 is move_to_point
+             * @param end_tolerance Distance from the target to end the movement at
+             * @param timeout Amount of time to wait before exiting the movement
+             * @param exit_velocity Slowest velocity to drive at and leave the robot driving at, in inches per second - 0 to stop,
+             *                      otherwise the movement ends once the robot drives past the target
+             * @param async Whether to run the movement on its own task and return right away
+             * @param exit_condition Conditions to end the movement with, on the distance to the target in inches - replace the end tolerance when any are turned on
+             */
+            void move_to_pose(const Pos desired_pose, const bool forwards = true, float lead = 0.7, float end_tolerance = 2.0, float timeout = 2000,
+                float exit_velocity = 0.0, bool async = false, knights::ExitCondition exit_condition = knights::ExitCondition());
 
             /**
              * @brief Turn the robot to a specific angle
@@ -63,8 +256,31 @@ namespace knights {
              *                      - this is used to account for the center of the bot not being the front
              * @param timeout Amount of time to wait before exiting the movement
              * @param rad Whether the provided angle is in radians or not
+             * @param async Whether to run the movement on its own task and return right away
+             * @param exit_condition Conditions to end the movement with, on the angle left in degrees - replace the end tolerance when any are turned on
+             */
+            void turn_to_angle(const float angle, int direction,float end_tolerance = 3.0, float timeout = 2000, bool rad = false, bool async = false,
+                knights::ExitCondition exit_condition = knights::ExitCondition()); // DEGREES
+
+            /**
+             * @brief Turn the robot to a specific angle along a trapezoidal or S-curve profile.
+             * 
+             *  The profile is planned from the robot's current angular velocity, the feedforward model drives it and the PID
+             *  controller corrects the angle measured by the odometry or IMU against it. Holonomic drivetrains turn like turn_to_angle, without the profile.
+             * 
+             * @param angle Angle to turn to
+             * @param direction Whether to turn left (-1), right (1), or best direction (0)
+             * @param max_velocity Fastest angular velocity, in degrees per second (radians if rad)
+             * @param max_acceleration Fastest angular acceleration, in degrees per second squared (radians if rad)
+             * @param max_jerk Fastest change in angular acceleration, in degrees per second cubed (radians if rad) - 0 for a trapezoidal profile
+             * @param end_tolerance Angle from the target to end at once the profile is done, in degrees (radians if rad)
+             * @param timeout Amount of time to wait before exiting the movement
+             * @param rad Whether the provided angles are in radians or not
+             * @param async Whether to run the movement on its own task and return right away
+             * @param exit_condition Conditions to end the movement with, on the angle left in degrees - replace the end tolerance when any are turned on
              */
-            void turn_to_angle(const float angle, int direction,float end_tolerance = 3.0, float timeout = 2000, bool rad = false); // DEGREES
+            void profiled_turn_to_angle(const float angle, int direction, float max_velocity, float max_acceleration, float max_jerk = 0.0,
+                float end_tolerance = 1.0, float timeout = 2000, bool rad = false, bool async = false, knights::ExitCondition exit_condition = knights::ExitCondition());
 
             /**
              * @brief Move in a straight line, forwards or backwards
@@ -73,8 +289,31 @@ namespace knights {
              * @param end_tolerance Position that the bot will stop moving at (ie if this is 5, the bot will stop moving 5 inches before the position) 
              *                      - this is used to account for the center of the bot not being the front
              * @param timeout Amount of time to wait before exiting the move
+             * @param exit_velocity Velocity to leave the robot driving at when the move ends, in inches per second - 0 to stop
+             * @param async Whether to run the movement on its own task and return right away
+             * @param exit_condition Conditions to end the movement with, on the distance left in inches - replace the end tolerance when any are turned on
              */
-            void lateral_move(const float distance, float end_tolerance = 3.0, float timeout = 750);
+            void lateral_move(const float distance, float end_tolerance = 3.0, float timeout = 750, float exit_velocity = 0.0, bool async = false,
+                knights::ExitCondition exit_condition = knights::ExitCondition());
+
+            /**
+             * @brief Move in a straight line along a trapezoidal or S-curve profile, forwards or backwards.
+             * 
+             *  The profile is planned from the robot's current velocity, the feedforward model drives it and the PID controller
+             *  corrects the distance measured by the odometry (or the motor encoders) against it. Holonomic drivetrains move like lateral_move, without the profile.
+             * 
+             * @param distance Distance to move, positive for forward, negative for backward
+             * @param max_velocity Fastest velocity, in inches per second
+             * @param max_acceleration Fastest acceleration, in inches per second squared
+             * @param max_jerk Fastest change in acceleration, in inches per second cubed - 0 for a trapezoidal profile
+             * @param end_tolerance Distance from the target to end at once the profile is done
+             * @param timeout Amount of time to wait before exiting the move
+             * @param exit_velocity Velocity to end the profile at and leave the robot driving at, in inches per second - 0 to stop
+             * @param async Whether to run the movement on its own task and return right away
+             * @param exit_condition Conditions to end the movement with, on the distance left in inches - replace the end tolerance when any are turned on
+             */
+            void profiled_lateral_move(const float distance, float max_velocity, float max_acceleration, float max_jerk = 0.0, float end_tolerance = 1.0,
+                float timeout = 3000, float exit_velocity = 0.0, bool async = false, knights::ExitCondition exit_condition = knights::ExitCondition());
 
             /**
              * @brief Turn the robot left or right for a certain angle
@@ -84,8 +323,19 @@ namespace knights {
              *                      - this is used to account for the center of the bot not being the front
              * @param timeout Amount of time to wait before exiting the movement
              * @param rad Whether the provided angle is in radians or not
+             * @param async Whether to run the movement on its own task and return right away
+             * @param exit_condition Conditions to end the movement with, on the angle left in degrees - replace the end tolerance when any are turned on
+             */
+            void turn_for(const float angle, const float end_tolerance = 2.0, float timeout= 750, bool rad = false, bool async = false,
+                knights::ExitCondition exit_condition = knights::ExitCondition()); // DEGREES
+
+            /**
+             * @brief Wait for both sides of the drivetrain to slow down under a velocity
+             * 
+             * @param settle_velocity Velocity the robot is settled under, in inches per second
+             * @param timeout Longest amount of time to wait
              */
-            void turn_for(const float angle, const float end_tolerance = 2.0, float timeout= 750, bool rad = false); // DEGREES
+            void wait_until_settled(float settle_velocity = DEFAULT_SETTLE_VELOCITY, float timeout = SETTLE_TIMEOUT);
 
 
     };
@@ -0,0 +1,112 @@
+#pragma once
+
+#ifndef _EKF_H
+#define _EKF_H
+
+#include "knights/util/position.h"
+
+namespace knights {
+
+    struct MotionIncrement {
+        float forward = 0.0; // distance moved along the robot's heading, in inches
+        float lateral = 0.0; // distance moved to the robot's left, in inches
+        float heading = 0.0; // change in heading, in radians counterclockwise
+
+        // variance of each part, negative if the source doesn't measure it
+        float forward_variance = -1.0;
+        float lateral_variance = -1.0;
+        float heading_variance = -1.0;
+
+        /**
+         * @brief Combine increments measured by different sources into one, each part weighted by the inverse of its variance
+         *
+         * @param increments the increments to combine
+         * @param amount amount of increments
+         * @return The combined increment, parts no source measured are 0 with a negative variance
+         */
+        static MotionIncrement fuse(const MotionIncrement *increments, int amount);
+    };
+
+    struct EKFNoise {
+        float tracker_variance = 0.0004; // variance of tracking wheel distance, in square inches per inch travelled
+        float tracker_heading_variance = 0.00002; // variance of the heading change from two parallel tracking wheels, in square radians per inch travelled
+        float motor_variance = 0.01; // variance of drive encoder distance, in square inches per inch travelled - higher, the drive wheels slip
+        float motor_heading_variance = 0.0004; // variance of the heading change from the drive encoders, in square radians per inch travelled
+        float lateral_variance = 0.002; // variance of sideways slip when nothing measures it, in square inches per inch travelled
+        float imu_rate_variance = 0.000001; // variance of the heading change from the IMU rate, in square radians per update
+        float imu_heading_variance = 0.0001; // variance of the IMU heading, in square radians
+        float minimum_variance = 0.000001; // smallest variance of any increment, so a source that didn't move isn't trusted completely
+    };
+
+    class PoseEKF {
+        private:
+            float state[3] = {0, 0, 0}; // x, y, heading
+            float covariance[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+            EKFNoise noise;
+        public:
+            /**
+             * @brief Construct a new Pose EKF object
+             *
+             * @param noise variances of the sensors, tune them with how far the estimate drifts
+             */
+            PoseEKF(EKFNoise noise = EKFNoise());
+
+            /**
+             * @brief Start the estimate over at a pose
+             *
+             * @param pose pose to start at, heading in radians
+             * @param position_variance variance of the x and y of the pose, in square inches
+             * @param heading_variance variance of the heading of the pose, in square radians
+             */
+            void reset(Pos pose, float position_variance = 0.0, float heading_variance = 0.0);
+
+            /**
+             * @brief Get the variances of the sensors
+             *
+             * @return The noise settings of the filter
+             */
+            const EKFNoise &get_noise() const;
+
+            /**
+             * @brief Prediction step, move the estimate by an increment relative to the robot and grow the covariance by its variance.
+             *  Parts of the increment with a negative variance are treated as 0 with the minimum variance
+             *
+             * @param increment how far the robot moved since the last prediction
+             */
+            void predict(MotionIncrement increment);
+
+            /**
+             * @brief Measurement step with an absolute heading, like the IMU's
+             *
+             * @param heading measured heading, in radians
+             * @param variance variance of the measurement, in square radians
+             */
+            void update_heading(float heading, float variance);
+
+            /**
+             * @brief Measurement step with an absolute position, like one from a localizer
+             *
+             * @param x measured x, in inches
+             * @param y measured y, in inches
+             * @param variance variance of each coordinate of the measurement, in square inches
+             */
+            void update_position(float x, float y, float variance);
+
+            /**
+             * @brief Get the estimated pose
+             *
+             * @return The estimate, heading in radians [0, 2pi)
+             */
+            Pos get_pose() const;
+
+            /**
+             * @brief Get the covariance of the estimate, in order x, y, heading
+             *
+             * @param covariance where to copy the 3x3 covariance to
+             */
+            void get_covariance(float covariance[3][3]) const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+
+#ifndef _EXIT_CONDITION_H
+#define _EXIT_CONDITION_H
+
+namespace knights {
+
+    enum exit_reason {
+        NOT_EXITED, // the movement should keep running
+        SMALL_ERROR, // error stayed inside the small window long enough
+        LARGE_ERROR, // error stayed inside the large window long enough
+        STALLED, // velocity stayed under the stall velocity long enough
+        TIMED_OUT // the movement ran longer than its timeout
+    };
+
+    class ExitCondition {
+        private:
+            // windows that end the movement once the error stays inside them for a time, negative to turn off
+            float small_error = -1.0; float small_time = 0.0;
+            float large_error = -1.0; float large_time = 0.0;
+
+            // velocity the robot is stalled under, and for how long, negative to turn off
+            float stall_velocity = -1.0; float stall_time = 0.0;
+
+            // longest the movement can run, in milliseconds, negative to turn off
+            float timeout = -1.0;
+
+            // time the movement started and each window was entered, negative if not yet
+            float start_time = -1.0;
+            float small_start = -1.0; float large_start = -1.0; float stall_start = -1.0;
+            bool moving = false; // the robot has gone faster than the stall velocity, every movement starts from rest under it
+
+            exit_reason reason = NOT_EXITED;
+
+            /**
+             * @brief Check if a value has been inside a window for long enough
+             *
+             * @param inside whether the value is inside the window right now
+             * @param entered time the window was entered, updated by this call
+             * @param hold time the value has to stay inside, in milliseconds
+             * @param time current time, in milliseconds
+             * @return true if the value has been inside the window for the hold time
+             */
+            static bool held(bool inside, float &entered, float hold, float time);
+        public:
+            /**
+             * @brief Construct an Exit Condition object with every condition turned off
+             */
+            ExitCondition();
+
+            /**
+             * @brief Construct a new Exit Condition object with error windows and a timeout
+             *
+             * @param small_error size of the small error window, in the units of the movement (inches or degrees)
+             * @param small_time time the error has to stay in the small window, in milliseconds
+             * @param large_error size of the large error window, in the units of the movement
+             * @param large_time time the error has to stay in the large window, in milliseconds
+             * @param timeout longest the movement can run, in milliseconds - negative for no timeout
+             */
+            ExitCondition(float small_error, float small_time, float large_error, float large_time, float timeout = -1.0);
+
+            /**
+             * @brief Set the small error window, usually tight and held briefly
+             *
+             * @param error size of the window, in the units of the movement (inches or degrees) - negative to turn off
+             * @param time time the error has to stay in the window, in milliseconds
+             */
+            void set_small_error(float error, float time);
+
+            /**
+             * @brief Set the large error window, usually loose and held longer, for when the robot settles short of the target
+             *
+             * @param error size of the window, in the units of the movement (inches or degrees) - negative to turn off
+             * @param time time the error has to stay in the window, in milliseconds
+             */
+            void set_large_error(float error, float time);
+
+            /**
+             * @brief Set the stall detection, the movement ends if the robot stays under a velocity, e.g. pushed against a wall.
+             *  It only starts once the robot has gone faster than the velocity, so a robot that never gets moving is left to the timeout
+             *
+             * @param velocity velocity the robot is stalled under, in inches per second (degrees per second for turns) - negative to turn off
+             * @param time time the robot has to stay under the velocity, in milliseconds
+             */
+            void set_stall(float velocity, float time);
+
+            /**
+             * @brief Set the longest the movement can run, measured on the clock instead of counting loops
+             *
+             * @param timeout time in milliseconds - negative for no timeout
+             */
+            void set_timeout(float timeout);
+
+            /**
+             * @brief Check if any condition is turned on
+             *
+             * @return true if at least one condition is turned on
+             */
+            bool enabled() const;
+
+            /**
+             * @brief Clear the windows and start time, call at the start of each movement
+             */
+            void reset();
+
+            /**
+             * @brief Check the conditions with this loop's values
+             *
+             * @param error distance from the target, in the units of the movement (inches or degrees)
+             * @param velocity velocity of the robot, in inches per second (degrees per second for turns)
+             * @param time current time, in milliseconds
+             * @return true if the movement should end
+             */
+            bool update(float error, float velocity, float time);
+
+            /**
+             * @brief Get the condition that ended the movement
+             *
+             * @return exit_reason - NOT_EXITED if update hasn't returned true since the last reset
+             */
+            exit_reason get_reason() const;
+    };
+
+}
+
+#endif
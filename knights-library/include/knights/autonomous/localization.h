@@ -0,0 +1,203 @@
+#pragma once
+
+#ifndef _LOCALIZATION_H
+#define _LOCALIZATION_H
+
+#include "knights/util/position.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// default amount of particles, raise it if the brain has the time to spare
+#define MCL_PARTICLES 300
+// length of the inside of the field walls, in inches
+#define FIELD_WIDTH 140.4
+// furthest the V5 distance sensor measures, in inches
+#define DISTANCE_SENSOR_RANGE 78.0
+
+namespace knights {
+
+    class FieldMap {
+        private:
+            // wall segments, stored as separate arrays so the ray cast goes over all particles at once
+            std::vector<float> start_x, start_y, end_x, end_y;
+        public:
+            /**
+             * @brief Add a wall, or a side of an obstacle, the distance sensors can see
+             *
+             * @param x1 x of one end, in inches
+             * @param y1 y of one end, in inches
+             * @param x2 x of the other end, in inches
+             * @param y2 y of the other end, in inches
+             */
+            void add_segment(float x1, float y1, float x2, float y2);
+
+            /**
+             * @brief Add the four sides of a rectangle, like the field walls or a goal
+             *
+             * @param min_x x of the left side, in inches
+             * @param min_y y of the bottom side, in inches
+             * @param max_x x of the right side, in inches
+             * @param max_y y of the top side, in inches
+             */
+            void add_box(float min_x, float min_y, float max_x, float max_y);
+
+            /**
+             * @brief Create a map of only the field walls, with the origin in a corner
+             *
+             * @param width length of the inside of the walls, in inches
+             * @return The field map
+             */
+            static FieldMap perimeter(float width = FIELD_WIDTH);
+
+            /**
+             * @brief Get the amount of wall segments
+             *
+             * @return Amount of segments in the map
+             */
+            int size() const;
+
+            /**
+             * @brief Distance along a ray to the closest wall
+             *
+             * @param x x the ray starts at, in inches
+             * @param y y the ray starts at, in inches
+             * @param angle direction of the ray, in radians
+             * @param max_range distance returned if no wall is hit, in inches
+             * @return Distance to the closest wall, in inches
+             */
+            float ray_cast(float x, float y, float angle, float max_range) const;
+
+            /**
+             * @brief Distance to the closest wall along many rays at once
+             *
+             * @param x x each ray starts at, in inches
+             * @param y y each ray starts at, in inches
+             * @param cos_angle cosine of the direction of each ray
+             * @param sin_angle sine of the direction of each ray
+             * @param amount amount of rays
+             * @param max_range distance given if no wall is hit, in inches
+             * @param distances where to write the distance of each ray to
+             */
+            void ray_cast(const float *x, const float *y, const float *cos_angle, const float *sin_angle, int amount, float max_range,
+                float *distances) const;
+    };
+
+    struct BeamSensor {
+        float forward = 0.0; // how far in front of the tracking center the sensor is, in inches
+        float left = 0.0; // how far to the left of the tracking center the sensor is, in inches
+        float angle = 0.0; // direction the sensor faces relative to the front of the robot, in radians counterclockwise
+        float max_range = DISTANCE_SENSOR_RANGE; // readings further than this are ignored, in inches
+
+        BeamSensor(float forward = 0.0, float left = 0.0, float angle = 0.0, float max_range = DISTANCE_SENSOR_RANGE);
+    };
+
+    struct LocalizerNoise {
+        float forward = 0.05; // spread of the forward motion, as a fraction of the distance moved
+        float lateral = 0.05; // spread of the sideways motion, as a fraction of the distance moved
+        float heading = 0.02; // spread of the turn, in radians per radian turned
+        float heading_per_inch = 0.002; // spread of the turn, in radians per inch moved
+        float minimum_position = 0.02; // spread of the position every update, even standing still, in inches
+        float minimum_heading = 0.002; // spread of the heading every update, even standing still, in radians
+        float sensor = 0.6; // spread of a distance reading, in inches
+        float sensor_fraction = 0.05; // spread of a distance reading, as a fraction of the distance
+        float outlier = 0.1; // chance a reading sees something that isn't on the map, like another robot
+    };
+
+    class MonteCarloLocalizer {
+        private:
+            const FieldMap *map;
+            std::vector<BeamSensor> sensors;
+            LocalizerNoise noise;
+            std::mt19937 random;
+
+            // particles as separate arrays so every step is one loop over plain floats
+            std::vector<float> x, y, heading, weight;
+
+            // scratch space for the measurement step
+            std::vector<float> cos_heading, sin_heading, ray_x, ray_y, ray_cos, ray_sin, expected, log_weight;
+
+            /**
+             * @brief Draw a new set of particles, each chosen by its weight
+             *
+             * @param particles amount of particles to draw
+             */
+            void resample(int particles);
+        public:
+            /**
+             * @brief Construct a new Monte Carlo Localizer object
+             *
+             * @param map a pointer to the walls the distance sensors see, has to outlive the localizer
+             * @param sensors where each distance sensor is on the robot, readings are given in the same order
+             * @param particles amount of particles, more is more accurate and takes longer
+             * @param noise how much the motion and readings are trusted
+             * @param seed seed of the random numbers, the same seed gives the same results
+             */
+            MonteCarloLocalizer(const FieldMap *map, std::vector<BeamSensor> sensors, int particles = MCL_PARTICLES,
+                LocalizerNoise noise = LocalizerNoise(), std::uint32_t seed = 0);
+
+            /**
+             * @brief Spread the particles around a starting pose
+             *
+             * @param pose the most likely pose, heading in radians
+             * @param position_spread standard deviation of x and y, in inches
+             * @param heading_spread standard deviation of the heading, in radians
+             */
+            void initialize(Pos pose, float position_spread = 1.0, float heading_spread = 0.02);
+
+            /**
+             * @brief Change the amount of particles, keeping the distribution
+             *
+             * @param particles new amount of particles
+             */
+            void set_particle_count(int particles);
+
+            /**
+             * @brief Get the amount of particles
+             *
+             * @return Amount of particles
+             */
+            int get_particle_count() const;
+
+            /**
+             * @brief Motion step, move every particle by the odometry's change in pose plus noise
+             *
+             * @param previous odometry pose at the last motion step
+             * @param current odometry pose now
+             */
+            void predict(Pos previous, Pos current);
+
+            /**
+             * @brief Measurement step, weigh every particle by how well the walls it would see match the readings
+             *
+             * @param distances reading of each sensor in inches, in the order of the sensors - negative if there is no reading
+             * @return Amount of readings used
+             */
+            int update(const float *distances);
+
+            /**
+             * @brief Get the weighted average pose of the particles
+             *
+             * @return The estimate, heading in radians [0, 2pi)
+             */
+            Pos get_estimate() const;
+
+            /**
+             * @brief Get how spread out the particles are
+             *
+             * @return Weighted standard deviation of the distance of the particles from the estimate, in inches
+             */
+            float get_spread() const;
+
+            /**
+             * @brief Get the effective amount of particles, low when only a few particles fit the readings
+             *
+             * @return Effective sample size of the weights
+             */
+            float get_effective_particles() const;
+    };
+
+}
+
+#endif
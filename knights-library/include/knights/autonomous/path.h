@@ -5,34 +5,22 @@
 
 #include <string>
 #include <vector>
-#include <map>
+#include <istream>
+#include <ostream>
 
 #include "knights/util/position.h"
-#include "knights/driver/input.h"
-#include "knights/robot/chassis.h"
-#include "knights/autonomous/pid.h"
+#include "knights/util/route.h"
+#include "knights/autonomous/profile.h"
 
 namespace knights {
 
-    struct Route {
-        std::vector<Pos> positions;
+    // declared here instead of included so routes can be read and written without PROS
+    class RobotChassis;
+    class PIDController;
 
-        /**
-         * @brief Construct a new Route object
-         * 
-         * @param positions A vector of positions for the route, this can be read out of a file or inputted manually
-         */
-        Route(std::vector<Pos> positions);
-
-        /**
-         * @brief Construct a new Route object with an empty position vector
-         * 
-         */
-        Route();
-
-        float length_dist();
-
-    };
+    namespace input {
+        class AutonomousInputMap;
+    }
 
     enum action_type {
         LATERAL,
@@ -41,25 +29,38 @@ namespace knights {
         COMMAND
     };
 
+    // when the action after a route action may start
+    enum start_condition {
+        IMMEDIATE, // as soon as this action ends, leaving the robot at the action's exit velocity
+        SETTLED, // once the robot has slowed down under a velocity
+        AFTER_DELAY // after waiting a set time
+    };
+
+#define DEFAULT_SETTLE_VELOCITY 1.0 // velocity the robot has settled under by default, in inches per second
+#define SETTLE_TIMEOUT 500 // longest to wait for the robot to settle, in milliseconds
+
     struct RouteAction { 
        action_type type;  
-       std::string route_name = "none";
-       float specific;
-       float end_tolerance;
-       int timeout;
-       float lookahead;
+       int route_index = -1;
+       float specific = 0.0;
+       float end_tolerance = 0.0;
+       int timeout = 0;
+       float lookahead = 0.0;
        std::string function_name;
+       start_condition next_start = start_condition::SETTLED; // when the next action may start
+       float next_value = DEFAULT_SETTLE_VELOCITY; // settle velocity in inches per second, or delay in milliseconds
+       float exit_velocity = 0.0; // velocity to leave the robot at when the next action starts immediately, in inches per second
 
         /**
          * @brief Construct a new Route Action object - presumed with follow type
          * 
          * @param type action type for the route (lateral, turn, follow, command)
-         * @param route_name name of route to follow - only used if it is a follow
+         * @param route_index index of the route to follow in the advanced route - only used if it is a follow
          * @param end_tolerance end tolerance for movement - only used if it is a lateral, turn, or follow
          * @param timeout timeout for movement - only used if it is a lateral, turn, or follow
          * @param lookahead lookahead for pure pursuit - only used if it is a follow
          */
-       RouteAction(action_type type, std::string route_name, float end_tolerance, int timeout, float lookahead);
+       RouteAction(action_type type, int route_index, float end_tolerance, int timeout, float lookahead);
 
         /**
          * @brief Construct a new Route Action object - presumed with lateral or turn type
@@ -81,8 +82,9 @@ namespace knights {
     };
 
     struct AdvancedRoute {
-        std::map<std::string, Route> routes;
+        std::vector<Route> routes; // routes for follow actions, addressed by RouteAction::route_index
         std::vector<RouteAction> actions;
+        std::vector<std::vector<ProfileTimestamp>> profiles; // precompiled trajectories with the same index as routes, tracked with RAMSETE when not empty
 
         /**
          * @brief Run an advanced route object
@@ -94,13 +96,25 @@ namespace knights {
          */
         void execute(knights::RobotChassis *chassis, knights::PIDController *lateral_pid, knights::PIDController *turn_pid, knights::input::AutonomousInputMap *input_map);
 
+        /**
+         * @brief Get the velocity the robot is carrying into an action from the motions before it.
+         * 
+         *  This is the exit velocity of the last motion before the action, as long as it and every command
+         *  after it start the next action immediately, and it drives the same way as the action - a motion
+         *  that reverses direction starts from 0.
+         * 
+         * @param action_index index of the action
+         * @return Entry velocity of the action, in inches per second
+         */
+        float entry_velocity(int action_index) const;
+
         /**
          * @brief Construct a new Advanced Route object with given routes and action list
          * 
-         * @param routes Map of routes in the movement; these will be used for the path following algorithm
+         * @param routes Routes in the movement, addressed by the route index of follow actions; these will be used for the path following algorithm
          * @param actions Array of actions for the route
          */
-        AdvancedRoute(std::map<std::string, Route> routes, std::vector<RouteAction> actions);
+        AdvancedRoute(std::vector<Route> routes, std::vector<RouteAction> actions);
 
         /**
          * @brief Construct a new Advanced Route object with empty routes and empty actions
@@ -110,38 +124,42 @@ namespace knights {
     };
 
     /**
-     * @brief Append one route to another
+     * @brief Read a route from an SD card file
      * 
-     * @param r1 the route to append to
-     * @param r2 the route to append
-     * @return Route 
+     * @param route_name The name and extension of the file to look for (ex. "file.txt")
      */
-    Route operator+(const Route &r1, const Route &r2);
+    Route init_route_from_sd(std::string route_name);
 
     /**
-     * @brief Add a position to a route
+     * @brief Parse an advanced route from the text format (rs/ps/ts/cs/eof) written by the path planner.
+     * 
+     *  The stream is read in large blocks and tokenized in place, so no strings are made for the tokens.
      * 
-     * @param r1 the route to add to
-     * @param p1 the position to add
-     * @return Route 
+     * @param stream stream to read the route from
+     * @return knights::AdvancedRoute 
      */
-    Route operator+(Route r1, const Pos &p1);
+    AdvancedRoute parse_advanced_route(std::istream &stream);
 
     /**
-     * @brief Remove a number of positions from the end of a route
+     * @brief Write an advanced route in the compiled binary format: a versioned and checksummed header, an action table,
+     *        a route table, then the packed positions, geometry cache and trajectories of each route
      * 
-     * @param r1 the route to remove positions from
-     * @param amt the amount of poitions to remove
-     * @return Route 
+     * @param stream stream to write to, should be opened in binary mode
+     * @param route the route to write
+     * @return true if everything was written
      */
-    Route operator-(Route r1, const int &amt);
+    bool write_compiled_route(std::ostream &stream, const AdvancedRoute &route);
 
     /**
-     * @brief Read a route from an SD card file
+     * @brief Read an advanced route from a buffer holding a whole compiled route file.
      * 
-     * @param route_name The name and extension of the file to look for (ex. "file.txt")
+     *  The positions, geometry cache and trajectories are copied straight out of the buffer, nothing is parsed or recomputed.
+     * 
+     * @param data contents of the file
+     * @param size size of the file in bytes
+     * @return knights::AdvancedRoute, empty if the data isn't a compiled route of this version or the checksum doesn't match
      */
-    Route init_route_from_sd(std::string route_name);
+    AdvancedRoute read_compiled_route(const char *data, size_t size);
 }
 
 /**
@@ -152,4 +170,12 @@ namespace knights {
  */
 knights::AdvancedRoute advanced_route_from_file(std::string file_name);
 
+/**
+ * @brief Read a compiled advanced route (made by tools/route_compiler.cpp) from a file on the brain microSD card
+ * 
+ * @param file_name Name of the file to read from - DO NOT include the /usd/, this will automatically be added (ex: "autonomous.krc")
+ * @return knights::AdvancedRoute 
+ */
+knights::AdvancedRoute compiled_route_from_file(std::string file_name);
+
 #endif
\ No newline at end of file
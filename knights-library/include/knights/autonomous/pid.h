@@ -3,8 +3,28 @@
 #ifndef _PID_H
 #define _PID_H
 
+#include <vector>
+
+// loop period the tuner values are scaled to, in milliseconds - gains tuned at the usual 10 ms loop stay the same
+#define PID_LOOP_PERIOD 10.0
+
 namespace knights {
 
+    struct PIDGains {
+        float min_error; // smallest error magnitude these gains are used for
+        float kP, kI, kD; // tuner values used at or above min_error
+
+        /**
+         * @brief Construct a new PID Gains object for gain scheduling
+         *
+         * @param min_error smallest error magnitude these gains are used for
+         * @param kP proportional tuner value
+         * @param kI integral tuner value
+         * @param kD derivative tuner value
+         */
+        PIDGains(float min_error, float kP, float kI, float kD);
+    };
+
     class PIDController {
         private:
             // tuner values for the PID calculation
@@ -13,11 +33,30 @@ namespace knights {
             // values to clamp the PID to
             float max_velocity = 127.0; float min_velocity = 0.0;
 
+            // largest value the integral term can add to the output, negative means the max velocity
+            float integral_limit = -1.0;
+
+            // clear the integral when the error changes sign so it doesn't push past the target
+            bool reset_integral_on_cross = true;
+
+            // weight of the previous derivative in the low pass filter, 0 is no filtering
+            float derivative_filter = 0.0;
+
+            // tuner values used instead of kP, kI, kD by error magnitude, sorted by min_error
+            std::vector<PIDGains> schedule;
+
+            // state carried between updates, cleared with reset()
+            float integral = 0.0;
+            float prev_error = 0.0;
+            float prev_measurement = 0.0;
+            float derivative = 0.0;
+            bool has_prev = false;
+
             friend class RobotController;
         public:
             /**
              * @brief Construct a new PID controller object
-             * 
+             *
              * @param kP proportional tuner value
              * @param kI integral tuner value
              * @param kD derivative tuner value
@@ -26,7 +65,7 @@ namespace knights {
 
             /**
              * @brief Construct a new PID controller object
-             * 
+             *
              * @param kP proportional tuner value
              * @param kI integral tuner value
              * @param kD derivative tuner value
@@ -41,8 +80,9 @@ namespace knights {
             PIDController();
 
             /**
-             * @brief Use the PID formula with the given tuner values in order to calculate a value that is adjusted for error
-             * 
+             * @brief Use the PID formula with the given tuner values in order to calculate a value that is adjusted for error.
+             *  Stateless, the caller keeps the error history
+             *
              * @param error desired value - current value
              * @param total_error compounded value of all error values
              * @param prev_error error from one iteration of the loop ago
@@ -50,16 +90,66 @@ namespace knights {
              */
             float update(float error, float total_error, float prev_error);
 
+            /**
+             * @brief Use the PID formula with the error history kept in the controller.
+             *  The integral is clamped and cleared when the error changes sign, and the derivative is taken on the
+             *  measurement so a change in target doesn't kick the output. The output keeps its sign, only its size is clamped
+             *  to the min and max velocity. Call reset() at the start of each movement
+             *
+             * @param target value the system should reach
+             * @param measurement current value of the system
+             * @param dt time since the last calculate, in milliseconds
+             * @param use_min_velocity whether to keep the output at least the min velocity - false when it corrects a feedforward and can go to 0
+             * @return a speed that is calculated with the PID formula
+             */
+            float calculate(float target, float measurement, float dt, bool use_min_velocity = true);
+
+            /**
+             * @brief Clear the integral and derivative history, the next calculate starts fresh
+             */
+            void reset();
+
+            /**
+             * @brief Set the largest value the integral term can add to the output
+             *
+             * @param limit largest output from the integral term, negative to use the max velocity
+             */
+            void set_integral_limit(float limit);
+
+            /**
+             * @brief Set whether the integral is cleared when the error changes sign
+             *
+             * @param reset true to clear the integral on a sign change
+             */
+            void set_integral_reset(bool reset);
+
+            /**
+             * @brief Set the low pass filter on the derivative, filtered = alpha * previous + (1 - alpha) * new
+             *
+             * @param alpha weight of the previous derivative from 0 (no filtering) to just under 1
+             */
+            void set_derivative_filter(float alpha);
+
+            /**
+             * @brief Use different tuner values when the error is at least a certain size, e.g. a stronger kP far from the target
+             *
+             * @param min_error smallest error magnitude to use these tuner values for
+             * @param kP proportional tuner value
+             * @param kI integral tuner value
+             * @param kD derivative tuner value
+             */
+            void add_gain_schedule(float min_error, float kP, float kI, float kD);
+
             /**
              * @brief Get the maximum speed of the controller
-             * 
+             *
              * @return float - Maximum Speed of the controller
              */
             float get_max_speed();
 
             /**
              * @brief Get the minimum speed of the controller
-             * 
+             *
              * @return float - Minimum Speed of the controller
              */
             float get_min_speed();
@@ -68,4 +158,4 @@ namespace knights {
 
 }
 
-#endif
\ No newline at end of file
+#endif
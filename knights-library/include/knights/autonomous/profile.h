@@ -3,40 +3,161 @@
 #ifndef _PROFILE_H
 #define _PROFILE_H
 
-#include "knights/robot/drivetrain.h"
+#include <vector>
+
 #include "knights/util/position.h"
-#include "knights/autonomous/path.h"
+#include "knights/util/route.h"
 
 
 namespace knights {
 
+    class Drivetrain;
+
     struct ProfileTimestamp {
-        knights::Pos position;
-        float expected_velocity;
-        float time;
-        float right_speed;
-        float left_speed;
+        knights::Pos position; // position the robot should be at
+        float expected_velocity; // linear velocity of the robot, in inches per second
+        float time; // time since the start of the profile, in milliseconds
+        float right_speed; // velocity of the right side of the drivetrain, in inches per second
+        float left_speed; // velocity of the left side of the drivetrain, in inches per second
+        float angular_velocity; // angular velocity of the robot, in radians per second (positive is left)
+        float distance; // distance along the route, in inches
 
+        /**
+         * @brief Construct a new Profile Timestamp object
+         *
+         * @param position position the robot should be at
+         * @param expected_velocity linear velocity of the robot, in inches per second
+         * @param time time since the start of the profile, in milliseconds
+         * @param right_speed velocity of the right side of the drivetrain, in inches per second
+         * @param left_speed velocity of the left side of the drivetrain, in inches per second
+         * @param angular_velocity angular velocity of the robot, in radians per second (positive is left)
+         * @param distance distance along the route, in inches
+         */
         ProfileTimestamp(knights::Pos position, float expected_velocity, float time,
-            float right_speed, float left_speed);
+            float right_speed, float left_speed, float angular_velocity = 0.0, float distance = 0.0);
+
+        /**
+         * @brief Construct an empty Profile Timestamp object, used when loading compiled routes
+         */
+        ProfileTimestamp() = default;
+    };
+
+    struct ProfileState {
+        float position; // distance from the start of the profile
+        float velocity; // velocity at this time, in distance per second
+        float acceleration; // acceleration at this time, in distance per second squared
+    };
+
+    class MotionProfile {
+        private:
+            float distance = 0; // distance to move, always positive
+            float direction = 1; // sign of the distance that was asked for
+            float first_distance = 0, cruise_distance = 0; // distance covered by the first and cruise phases
+            float end_position = 0; // distance covered by the trapezoid
+            float start_velocity = 0, end_velocity = 0; // velocities at the ends, in distance per second
+            float peak_velocity = 0; // velocity between speeding up and slowing down
+            float first_acceleration = 0, last_acceleration = 0; // acceleration of the first and last phases, the last is negative to slow down
+            float first_time = 0, cruise_time = 0, last_time = 0; // length of each phase, in seconds
+            float jerk_time = 0; // width of the window the trapezoid is averaged over for an S-curve, 0 for a trapezoid
+
+            /**
+             * @brief Get the position of the trapezoidal profile, extended at the start and end velocities outside of it
+             */
+            float trapezoid_position(float time) const;
+
+            /**
+             * @brief Get the velocity of the trapezoidal profile, extended at the start and end velocities outside of it
+             */
+            float trapezoid_velocity(float time) const;
+
+            /**
+             * @brief Get the integral of the trapezoidal profile's position from time 0, for averaging it into an S-curve
+             */
+            float trapezoid_position_integral(float time) const;
+        public:
+            /**
+             * @brief Plan a one dimensional profile, trapezoidal or jerk limited (S-curve).
+             * 
+             *  The S-curve is the trapezoid averaged over a window of max_acceleration / max_jerk seconds, which limits the
+             *  jerk while keeping the distance and end velocities. It takes that window longer than the trapezoid.
+             * 
+             * @param distance distance to move, in any unit (inches, radians) - negative to move backwards
+             * @param max_velocity fastest velocity, in distance per second
+             * @param max_acceleration fastest acceleration, in distance per second squared
+             * @param max_jerk fastest change in acceleration, in distance per second cubed - 0 for a trapezoid
+             * @param start_velocity speed at the start, towards the target, in distance per second
+             * @param end_velocity speed at the end, towards the target, in distance per second
+             */
+            MotionProfile(float distance, float max_velocity, float max_acceleration, float max_jerk = 0.0,
+                float start_velocity = 0.0, float end_velocity = 0.0);
+
+            /**
+             * @brief Get the state the profile wants at a time
+             * 
+             * @param time time since the start of the profile, in seconds
+             * @return Position, velocity and acceleration, with the sign of the distance - continues at the end velocity after the profile is over
+             */
+            ProfileState at(float time) const;
+
+            /**
+             * @brief Get how long the profile takes
+             * 
+             * @return Length of the profile, in seconds
+             */
+            float duration() const;
     };
 
     class ProfileGenerator {
         private:
-            float rpm = 0;
-            float wheel_diameter = 0;
-            knights::Drivetrain *drivetrain = nullptr;
+            float max_velocity = 0; // fastest the robot can drive, in inches per second
+            float max_acceleration = 0; // fastest the robot can speed up or slow down, in inches per second squared
+            float max_lateral_acceleration = 0; // fastest the robot can accelerate sideways in a turn before slipping, in inches per second squared
+            float track_width = 0; // width from the right wheels to the left wheels
         public:
-            float speed = 0;
+            /**
+             * @brief Construct a new Profile Generator object with limits taken from a drivetrain
+             *
+             * @param drivetrain drivetrain to take the max velocity, max acceleration and track width from
+             * @param mass mass of the robot, in kilograms
+             * @param motor_amt amount of motors on the drivetrain
+             * @param max_lateral_acceleration fastest the robot can accelerate sideways in a turn, in inches per second squared
+             */
+            ProfileGenerator(knights::Drivetrain* drivetrain, float mass, float motor_amt, float max_lateral_acceleration);
 
-            ProfileGenerator(knights::Drivetrain* drivetrain);
+            /**
+             * @brief Construct a new Profile Generator object with the given limits
+             *
+             * @param max_velocity fastest the robot can drive, in inches per second
+             * @param max_acceleration fastest the robot can speed up or slow down, in inches per second squared
+             * @param max_lateral_acceleration fastest the robot can accelerate sideways in a turn, in inches per second squared
+             * @param track_width width from the right wheels to the left wheels
+             */
+            ProfileGenerator(float max_velocity, float max_acceleration, float max_lateral_acceleration, float track_width);
 
-            ProfileGenerator(float rpm, float wheel_diameter);
+            /**
+             * @brief Get the fastest velocity allowed at each position of a route, from the curvature and the limits
+             *
+             * @param route route to limit
+             * @return Velocity limit at each position of the route, in inches per second
+             */
+            std::vector<float> velocity_limits(const knights::Route &route);
 
-            std::vector<ProfileTimestamp> generate_profile(knights::Route route, knights::Pos start, knights::Drivetrain* drivetrain, 
-                float lookahead, float speed_max, float speed_min, float interval);
+            /**
+             * @brief Generate a time parameterized profile for a route.
+             *
+             *  The velocity at each position is limited by the curvature, then a forward pass limits how fast the
+             *  robot speeds up and a backward pass limits how fast it slows down. The result is sampled every interval.
+             *
+             * @param route route to follow, needs its geometry computed
+             * @param interval time between each timestamp, in milliseconds
+             * @param start_velocity velocity at the start of the route, in inches per second
+             * @param end_velocity velocity at the end of the route, in inches per second
+             * @return Timestamps from the start to the end of the route
+             */
+            std::vector<ProfileTimestamp> generate_profile(const knights::Route &route, float interval = 10.0,
+                float start_velocity = 0.0, float end_velocity = 0.0);
     };
 
 }
 
-#endif
\ No newline at end of file
+#endif
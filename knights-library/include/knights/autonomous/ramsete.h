@@ -10,8 +10,8 @@ namespace knights {
             /**
              * @brief Construct a new Ramsete Constants object
              * 
-             * @param damping Damping value for the Ramsete controller, must be greater than 0
-             * @param proportional Proportional value for the Ramsete controller, must be within (0,1)
+             * @param damping Damping value for the Ramsete controller (b), must be greater than 0
+             * @param proportional Proportional value for the Ramsete controller (zeta), must be within (0,1)
              */
             RamseteConstants(const float &damping, const float &proportional);
     };
@@ -5,8 +5,14 @@
 
 #include "liblvgl/lvgl.h"
 #include "knights/api.h"
+#include <cstdint>
 #include <string>
 
+// default time between refreshes of the position display, in milliseconds (20 Hz)
+#define DISPLAY_PERIOD 50
+// priority of the position display task, below movements and odometry so drawing never delays them
+#define DISPLAY_PRIORITY (TASK_PRIORITY_DEFAULT - 2)
+
 extern void lv_display(void);
 
 namespace knights::display {
@@ -73,6 +79,20 @@ namespace knights::display {
      */
     void change_curr_pos_dot(Pos pos);
 
+    /**
+     * @brief Start showing the chassis' position on the position label and dot, on its own low priority task.
+     *  It copies the newest position published by the chassis without locking, and only redraws when there is a new one
+     * 
+     * @param chassis chassis to show the position of
+     * @param period time between refreshes, in milliseconds
+     */
+    void start_position_display(knights::RobotChassis *chassis, std::uint32_t period = DISPLAY_PERIOD);
+
+    /**
+     * @brief Stop the position display task, the label and dot are left where they were
+     */
+    void stop_position_display();
+
 }
 
 #endif
\ No newline at end of file
@@ -5,11 +5,36 @@
 
 #include "api.h"
 
+#include "knights/autonomous/ekf.h"
+#include "knights/autonomous/localization.h"
+
 #include "knights/robot/drivetrain.h"
+#include "knights/robot/odometry.h"
 #include "knights/robot/position_tracker.h"
+#include "knights/robot/sensor_frame.h"
 
+#include "knights/util/pose_history.h"
 #include "knights/util/position.h"
+#include "knights/util/seqlock.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
+// default time between odometry updates, in milliseconds
+#define ODOMETRY_PERIOD 10
+// priority of the odometry task, above the default so movements and driver control can't delay it
+#define ODOMETRY_PRIORITY (TASK_PRIORITY_DEFAULT + 1)
+// sign of the IMU's z rate on the unit circle, the IMU turns clockwise positive like its heading
+#define IMU_RATE_DIRECTION -1
+// default time between localizer updates, in milliseconds - the distance sensors only measure every 33ms
+#define LOCALIZATION_PERIOD 50
+// priority of the localization task, below the odometry task so a slow update never delays it
+#define LOCALIZATION_PRIORITY (TASK_PRIORITY_DEFAULT - 1)
+// added to the square of the particles' spread when correcting the estimator, in square inches
+#define LOCALIZATION_VARIANCE 1.0
+// sensor frames older than this are read again when a velocity is asked for, the odometry task isn't updating them, in milliseconds
+#define SENSOR_FRAME_STALE_TIME 50
 
 namespace knights {
 
@@ -18,8 +43,60 @@ namespace knights {
             Drivetrain *drivetrain = nullptr; // the drivetrain to use for the chassis
             Holonomic *holonomic = nullptr; // the drivetrain to use for the chassis
             PositionTrackerGroup *pos_trackers = nullptr; // the sensors to use for location tracking
+            OdometrySource *odometry = nullptr; // odometry built for the robot's trackers at compile time, used instead of pos_trackers
+
+            // working copy of the position, only touched by the task writing it while holding position_mutex - everything else reads position_state
             Pos curr_position; // the current position of the robot
             Pos prev_position;
+            pros::Mutex position_mutex; // held while the position is being changed, so set_position can't be lost in an odometry update
+
+            struct ChassisState {
+                knights::PoseSample sample; // position, velocity and time it was measured at
+                Pos prev_position; // position at the update before
+                float covariance[3][3]; // covariance of the position from the estimator, 0 without one
+            };
+            knights::SeqLock<ChassisState> position_state; // the position published to every other task
+
+            /**
+             * @brief Publish the working copy of the position to readers and the pose history. Has to be called holding position_mutex
+             * 
+             * @param moved whether the robot moved to get here, false if the position was set so no velocity is measured
+             * @param time when the position was measured, in milliseconds
+             */
+            void publish_position(bool moved, std::uint32_t time);
+
+            knights::SeqLock<SensorFrame> sensor_state; // the newest sensor frame, published to every other task
+
+            /**
+             * @brief Read every sensor of the chassis once
+             * 
+             * @param frame where to write the readings to
+             */
+            void read_sensors(SensorFrame &frame);
+
+            /**
+             * @brief Update the position with the compiled odometry, it reads the tracking sensors into the frame
+             * 
+             * @param frame the readings of the drive motors, the tracking sensors are added to it
+             */
+            void update_odometry(SensorFrame &frame);
+
+            // pose estimator fusing every sensor, the position is only integrated from the trackers without one
+            knights::PoseEKF *estimator = nullptr;
+            bool estimator_reset = true; // start the estimator over from the working position on the next update
+            std::uint32_t estimator_time = 0; // time of the last estimator update, in milliseconds
+            float imu_heading_offset = 0.0; // chassis heading minus the IMU heading when the estimator was reset, in radians
+
+            /**
+             * @brief Move the estimator by the tracker increment and the other sensors' readings, and copy its pose to the working position.
+             *  Has to be called holding position_mutex
+             * 
+             * @param frame the sensor readings of this update
+             * @param forward distance the tracking wheels moved forward, relative to the robot
+             * @param lateral distance the tracking wheels moved to the left, relative to the robot
+             * @param tracker_heading change in heading from two parallel tracking wheels, NAN without them
+             */
+            void estimate_position(const SensorFrame &frame, float forward, float lateral, float tracker_heading);
 
             // previous values of the sensors for odometry control
             float prevRight = 0;
@@ -27,6 +104,34 @@ namespace knights {
             float prevFront = 0;
             float prevBack = 0;
 
+            // odometry task started by start_odometry()
+            pros::Task *odometry_task = nullptr;
+            std::atomic<bool> odometry_running = false; // cleared to ask the task to stop
+            std::atomic<bool> odometry_stopped = true; // set by the task once it has stopped
+            std::uint32_t odometry_period = ODOMETRY_PERIOD; // time between updates, in milliseconds
+            std::atomic<std::uint32_t> odometry_overruns = 0; // amount of updates that took longer than the period
+            knights::PoseHistory pose_history; // timestamped poses, every published position is added
+
+            /**
+             * @brief Loop of the odometry task, updates the position once every period and adds it to the pose history
+             */
+            void odometry_loop();
+
+            // localization task started by start_localization()
+            pros::Task *localization_task = nullptr;
+            std::atomic<bool> localization_running = false; // cleared to ask the task to stop
+            std::atomic<bool> localization_stopped = true; // set by the task once it has stopped
+            knights::MonteCarloLocalizer *localizer = nullptr; // only used by the localization task
+            std::vector<pros::Distance*> distance_sensors; // in the order of the localizer's sensors
+            std::atomic<bool> localizer_reset = false; // set_position moved the robot, start the particles over around it
+            std::uint32_t localization_period = LOCALIZATION_PERIOD; // time between updates, in milliseconds
+
+            /**
+             * @brief Loop of the localization task, moves the particles by the odometry, weighs them by the distance sensors
+             *  and corrects the position with where they are, through the estimator if there is one
+             */
+            void localization_loop();
+
             // declare the robot chassis class as a friend class, allows access into private objects
             friend class RobotController;
         public:
@@ -47,6 +152,22 @@ namespace knights {
              */
             RobotChassis(Holonomic *drivetrain, PositionTrackerGroup *pos_trackers);
 
+            /**
+             * @brief Construct a new Robot Chassis object
+             * 
+             * @param drivetrain a pointer to the drivetrain to use for the chassis
+             * @param odometry a pointer to the odometry for the robot's tracking wheels, like Odometry<Vertical<Rotation>, Horizontal<Rotation>, Imu>
+             */
+            RobotChassis(Drivetrain *drivetrain, OdometrySource *odometry);
+
+            /**
+             * @brief Construct a new Robot Chassis object
+             * 
+             * @param drivetrain a pointer to the drivetrain to use for the chassis
+             * @param odometry a pointer to the odometry for the robot's tracking wheels, like Odometry<Vertical<Rotation>, Horizontal<Rotation>, Imu>
+             */
+            RobotChassis(Holonomic *drivetrain, OdometrySource *odometry);
+
             /**
              * @brief Set the position of the chassis
              * 
@@ -71,6 +192,31 @@ namespace knights {
              */
             void update_position();
 
+            /**
+             * @brief Update the position of the chassis from sensor readings that were already taken, like a recorded frame.
+             *  The frame is published for get_sensor_frame()
+             * 
+             * @param frame the sensor readings to update from
+             */
+            void update_position(const SensorFrame &frame);
+
+            /**
+             * @brief Get the sensor readings the newest position was measured from, all taken at the same time.
+             *  Use this instead of reading the sensors again, so every task sees the same readings
+             * 
+             * @param frame where to copy the readings to
+             * @return Generation of the frame, changes every time new readings are taken
+             */
+            std::uint32_t get_sensor_frame(SensorFrame &frame);
+
+            /**
+             * @brief Get the velocity of the drivetrain relative to the robot, from the newest sensor frame.
+             *  Reads the motors itself if the frame is old, because the odometry task isn't running
+             * 
+             * @return The measured velocity, in inches per second and radians per second counterclockwise
+             */
+            knights::ChassisSpeeds get_measured_velocity();
+
             /**
              * @brief Get the current position of the chassis
              * 
@@ -95,6 +241,31 @@ namespace knights {
              */
             void set_prev_position(Pos position);
 
+            /**
+             * @brief Get the newest position, velocity and time it was measured at, all from the same update.
+             *  Never blocks the odometry task, and can be called from any task
+             * 
+             * @param sample where to copy the position to
+             * @return Generation of the position, changes every time a new position is published so a controller can tell if it has a new one
+             */
+            std::uint32_t get_snapshot(knights::PoseSample &sample);
+
+            /**
+             * @brief Get the current and previous positions, both from the same update
+             * 
+             * @param position where to copy the current position to
+             * @param prev_position where to copy the previous position to
+             * @return Generation of the positions
+             */
+            std::uint32_t get_positions(Pos &position, Pos &prev_position);
+
+            /**
+             * @brief Get the generation of the newest position without copying it
+             * 
+             * @return Amount of times the position has been published
+             */
+            std::uint32_t get_generation();
+
             /**
              * @brief Get the prev position of the chassis
              * 
@@ -102,6 +273,78 @@ namespace knights {
              */
             Pos get_prev_position();
 
+            /**
+             * @brief Start updating the position on its own task, at a fixed period no matter how long each update takes.
+             *  Every update is added to the pose history with the time it was measured at
+             * 
+             * @param period time between updates, in milliseconds
+             */
+            void start_odometry(std::uint32_t period = ODOMETRY_PERIOD);
+
+            /**
+             * @brief Stop the odometry task, waiting for its last update to finish
+             */
+            void stop_odometry();
+
+            /**
+             * @brief Get the timestamped poses measured by the odometry task, it can be read from any task without locking
+             * 
+             * @return The pose history of the chassis
+             */
+            const knights::PoseHistory &get_pose_history();
+
+            /**
+             * @brief Get the pose and velocity of the chassis at a past time, interpolated between odometry updates.
+             *  Used to line up sensor readings that are a few milliseconds old with where the robot was when they were taken
+             * 
+             * @param time time to get the pose at, in milliseconds since the program started (pros::millis())
+             * @param sample where to copy the pose to
+             * @return false if the odometry task hasn't measured a pose yet, or the time is older than the history kept
+             */
+            bool get_pose_at(std::uint32_t time, knights::PoseSample &sample);
+
+            /**
+             * @brief Get the amount of odometry updates that took longer than the period, and so delayed the next one
+             * 
+             * @return Amount of late updates since the odometry task started
+             */
+            std::uint32_t get_odometry_overruns();
+
+            /**
+             * @brief Estimate the position with an extended Kalman filter instead of only integrating the tracking wheels.
+             *  The tracking wheels, IMU heading and rate, and drive encoders are fused by how much each is trusted.
+             *  The estimator starts over from the current position
+             * 
+             * @param estimator a pointer to the estimator to use, nullptr to go back to the tracking wheels only
+             */
+            void set_estimator(knights::PoseEKF *estimator);
+
+            /**
+             * @brief Get the covariance of the position from the estimator, from the same update as get_position()
+             * 
+             * @param covariance where to copy the 3x3 covariance to, in order x, y, heading
+             * @return false if no estimator is set, the covariance is all 0
+             */
+            bool get_covariance(float covariance[3][3]);
+
+            /**
+             * @brief Start localizing the robot against the field walls with distance sensors, on its own task.
+             *  The particles start around the current position and are moved by the odometry, and start over when set_position is called.
+             *  Their position corrects the estimator, so the odometry only drifts as far as the localizer lets it. Without an estimator
+             *  the x and y are set to the particles' position on every update that saw a wall, and the heading is left to the odometry
+             * 
+             * @param localizer a pointer to the localizer to use, with the map and where each sensor is
+             * @param sensors the distance sensors, in the same order as the localizer's sensors
+             * @param period time between updates, in milliseconds
+             */
+            void start_localization(knights::MonteCarloLocalizer *localizer, std::vector<pros::Distance*> sensors,
+                std::uint32_t period = LOCALIZATION_PERIOD);
+
+            /**
+             * @brief Stop the localization task, waiting for its last update to finish
+             */
+            void stop_localization();
+
     };
 }
 
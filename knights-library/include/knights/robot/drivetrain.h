@@ -5,6 +5,12 @@
 
 #include "api.h"
 
+#include "knights/robot/feedforward.h"
+#include "knights/robot/kinematics.h"
+
+#include <cstdint>
+#include <string>
+
 namespace knights {
 
     class Drivetrain {
@@ -15,6 +21,27 @@ namespace knights {
             float rpm; // max rpm of the drivetrain (ie 450rpm, 600 rpm, etc)
             float wheel_diameter; // diameters of the largest wheels on the drivetrain
             float gear_ratio; // gear ratio of the drivetrain
+            knights::Feedforward right_feedforward; // voltage model of the right side, empty until set
+            knights::Feedforward left_feedforward; // voltage model of the left side, empty until set
+
+            // output stage, limits how fast the commanded velocity of each side changes - 0 turns it off
+            float output_max_acceleration = 0.0; // in inches per second squared
+            float output_max_jerk = 0.0; // in inches per second cubed
+            float output_right_velocity = 0.0; // last velocity sent to the right side, in inches per second
+            float output_left_velocity = 0.0; // last velocity sent to the left side, in inches per second
+            float output_right_acceleration = 0.0; // acceleration of the right side last command, in inches per second squared
+            float output_left_acceleration = 0.0; // acceleration of the left side last command, in inches per second squared
+            std::uint32_t output_time = 0; // time of the last command, in milliseconds
+
+            /**
+             * @brief Limit the change from the last command to the max acceleration and jerk. The targets are scaled together
+             *  when possible so the ratio between the sides (the curvature) is kept, otherwise both changes are scaled together
+             * 
+             * @param right_velocity target velocity for the right side in inches per second, changed to the velocity to send
+             * @param left_velocity target velocity for the left side in inches per second, changed to the velocity to send
+             * @return true if either velocity was limited
+             */
+            bool limit_output(float &right_velocity, float &left_velocity);
 
             friend class RobotChassis;
             friend class RobotController;
@@ -40,6 +67,91 @@ namespace knights {
              */
             void velocity_command(int rightMtrs, int leftMtrs);
 
+            /**
+             * @brief Bring the robot to a stop, slowing down as fast as the output limits let it, then stop the motors so they
+             *  hold with their brake mode. Waits until the robot has stopped, right away if there are no limits
+             */
+            void stop();
+
+            /**
+             * @brief Update the velocity of both sides of the drivetrain in physical units
+             * 
+             * @param right_velocity velocity for the right side, in inches per second
+             * @param left_velocity velocity for the left side, in inches per second
+             */
+            void physical_velocity_command(float right_velocity, float left_velocity);
+
+            /**
+             * @brief Update the voltage of both sides of the drivetrain
+             * 
+             * @param right_voltage voltage for the right motors, in volts from -12 to 12
+             * @param left_voltage voltage for the left motors, in volts from -12 to 12
+             */
+            void voltage_command(float right_voltage, float left_voltage);
+
+            /**
+             * @brief Drive both sides at a velocity and acceleration with the feedforward model of each side.
+             *  Falls back to physical_velocity_command if no model has been set
+             * 
+             * @param right_velocity velocity for the right side, in inches per second
+             * @param left_velocity velocity for the left side, in inches per second
+             * @param right_acceleration acceleration for the right side, in inches per second squared
+             * @param left_acceleration acceleration for the left side, in inches per second squared
+             */
+            void feedforward_command(float right_velocity, float left_velocity, float right_acceleration = 0.0, float left_acceleration = 0.0);
+
+            /**
+             * @brief Limit how fast the velocity sent to each side can change, so the wheels don't slip and throw the odometry off.
+             *  Every command goes through it except voltage_command, slowing down to 0 too - a single command of 0 only slows the
+             *  robot down by one step, so use stop() to end a movement
+             * 
+             * @param max_acceleration fastest change in velocity, in inches per second squared - the smaller of max_acceleration()
+             *                         and traction_acceleration() is the most the robot can do, 0 turns the limit off
+             * @param max_jerk fastest change in acceleration, in inches per second cubed - 0 for no jerk limit
+             */
+            void set_output_limits(float max_acceleration, float max_jerk = 0.0);
+
+            /**
+             * @brief Calculate the fastest the robot can accelerate before its wheels slip
+             * 
+             * @param friction_coefficient coefficient of friction between the wheels and the field tiles
+             * @return Max acceleration before slipping, in inches per second squared
+             */
+            float traction_acceleration(float friction_coefficient);
+
+            /**
+             * @brief Set the feedforward model of each side, from the constants found with tools/feedforward_fit
+             * 
+             * @param right_feedforward voltage model of the right side
+             * @param left_feedforward voltage model of the left side
+             */
+            void set_feedforward(knights::Feedforward right_feedforward, knights::Feedforward left_feedforward);
+
+            /**
+             * @brief Check if both sides have a feedforward model
+             * 
+             * @return true if both models have been set
+             */
+            bool has_feedforward();
+
+            /**
+             * @brief Run the characterization tests and log the voltage and velocity of each side to the SD card, for tools/feedforward_fit.
+             * 
+             *  Runs a quasistatic test (voltage slowly ramped up) and a dynamic test (a voltage step) forwards and then backwards,
+             *  stopping between each. The robot drives in a straight line, so it needs room in front of and behind it.
+             * 
+             *  The quasistatic ramp goes from 0 to ramp_rate * quasistatic_time volts, 7V with the defaults, so kV is fit over most
+             *  of the voltage range instead of just above kS. Lower the rate and raise the time together to keep that range in less room.
+             * 
+             * @param file_name Name of the file to write - DO NOT include the /usd/, this will automatically be added (ex: "characterization.csv")
+             * @param ramp_rate how fast the voltage goes up in the quasistatic tests, in volts per second
+             * @param step_voltage voltage of the dynamic tests, in volts
+             * @param quasistatic_time how long each quasistatic test runs, in milliseconds
+             * @param dynamic_time how long each dynamic test runs, in milliseconds
+             */
+            void characterize(std::string file_name, float ramp_rate = 0.5, float step_voltage = 6.0, float quasistatic_time = 14000,
+                float dynamic_time = 2000);
+
             /**
              * @brief Conversion function from distance to motor position (in degrees)
              * 
@@ -59,19 +171,33 @@ namespace knights {
             /**
              * @brief Calculate the max acceleration of the drivetrain
              * 
-             * @param mass Mass of the robot
+             * @param mass Mass of the robot, in kilograms
              * @param motor_amt Amount of motors on the drivetrain
-             * @param stall_torque Stall torque of the motors
-             * @return Max acceleration of the drivetrain
+             * @param stall_torque Stall torque of the motors, in newton meters
+             * @return Max acceleration of the drivetrain, in inches per second squared
              */
             float max_acceleration(float mass, float motor_amt, float stall_torque = 0.5);
 
             /**
              * @brief Calculate the maximum velocity of the drivetrain
              * 
-             * @return Maximum velocity of the drivetrain 
+             * @return Maximum velocity of the drivetrain, in inches per second
              */
             float max_velocity();
+
+            /**
+             * @brief Get the measured velocity of the right side of the drivetrain, from the motor encoders
+             * 
+             * @return Velocity of the right side, in inches per second
+             */
+            float right_velocity();
+
+            /**
+             * @brief Get the measured velocity of the left side of the drivetrain, from the motor encoders
+             * 
+             * @return Velocity of the left side, in inches per second
+             */
+            float left_velocity();
     };
 
     class Holonomic {
@@ -84,6 +210,34 @@ namespace knights {
             float rpm; // max rpm of the drivetrain (ie 450rpm, 600 rpm, etc)
             float wheel_diameter; // diameters of the largest wheels on the drivetrain
             float gear_ratio; // gear ratio of the drivetrain
+            knights::HolonomicKinematics kinematics; // wheel layout, turns robot velocities into wheel velocities
+
+            // output stage, limits how fast the commanded velocity of each wheel changes - 0 turns it off
+            float output_max_acceleration = 0.0; // in inches per second squared
+            float output_max_jerk = 0.0; // in inches per second cubed
+            knights::WheelSpeeds output_wheels; // last velocity sent to each wheel, in inches per second
+            float output_acceleration = 0.0; // acceleration of the fastest changing wheel last command, in inches per second squared
+            std::uint32_t output_time = 0; // time of the last command, in milliseconds
+
+            /**
+             * @brief Limit the change from the last command to the max acceleration and jerk. Every wheel's change is scaled
+             *  together, so the robot keeps the direction it was speeding up or slowing down in
+             * 
+             * @param wheels target velocity of each wheel in inches per second, changed to the velocities to send
+             * @return true if any velocity was limited
+             */
+            bool limit_output(knights::WheelSpeeds &wheels);
+
+            /**
+             * @brief Get the measured velocity of a wheel, from its motor encoder
+             * 
+             * @param motor motor of the wheel
+             * @return Velocity of the wheel's surface, in inches per second
+             */
+            float wheel_velocity(pros::Motor *motor);
+
+            friend class RobotChassis;
+            friend class RobotController;
         public:
             /**
              * @brief Construct a new holonomic drivetrain object
@@ -96,9 +250,11 @@ namespace knights {
              * @param rpm max rotations per minute of the wheels
              * @param wheel_diameter diameter of the biggest wheels used
              * @param gear_ratio gear ratio from the motors to the wheels
+             * @param type whether the wheels are an X-drive or mecanum
+             * @param wheel_base length between the front and back wheels, 0 to use the track width
              */
             Holonomic(pros::Motor *frontRight, pros::Motor *frontLeft, pros::Motor *backRight, pros::Motor *backLeft, 
-                float track_width, float rpm, float wheel_diameter, float gear_ratio = 1);
+                float track_width, float rpm, float wheel_diameter, float gear_ratio = 1, holonomic_type type = X_DRIVE, float wheel_base = 0.0);
 
            /**
             * @brief Update the velocities for the motors of the holonomic object
@@ -110,11 +266,86 @@ namespace knights {
             */
             void velocity_command(int frontRight, int frontLeft, int backRight, int backLeft);
 
-            /*
-            * @brief 
-            */
+            /**
+             * @brief Bring the robot to a stop, slowing down as fast as the output limits let it, then stop the motors so they
+             *  hold with their brake mode. Waits until the robot has stopped, right away if there are no limits
+             */
+            void stop();
+
+            /**
+             * @brief Limit how fast the velocity sent to each wheel can change, so the wheels don't slip and throw the odometry off.
+             *  Every command goes through it, slowing down to 0 too - a single command of 0 only slows the robot down by one step,
+             *  so use stop() to end a movement
+             * 
+             * @param max_acceleration fastest change in a wheel's velocity, in inches per second squared - 0 turns the limit off
+             * @param max_jerk fastest change in acceleration, in inches per second cubed - 0 for no jerk limit
+             */
+            void set_output_limits(float max_acceleration, float max_jerk = 0.0);
+
+            /**
+             * @brief Set the brake mode of every motor
+             * 
+             * @param mode brake mode to use when the motors are stopped
+             */
+            void set_brake_mode(pros::motor_brake_mode_e_t mode);
+
+            /**
+             * @brief Drive, strafe and turn at once relative to the robot. The commands are mixed into each wheel
+             *  and scaled down together if any wheel would go over full speed, so the direction is kept
+             * 
+             * @param forward speed forward, from -127 to 127
+             * @param left speed to the left, from -127 to 127
+             * @param turn speed to turn counterclockwise, from -127 to 127
+             */
+            void move(float forward, float left, float turn);
+
+            /**
+             * @brief Move the robot at a velocity in physical units, with the inverse kinematics of the wheels
+             * 
+             * @param speeds velocity of the robot, in inches per second and radians per second (counterclockwise positive)
+             */
+            void physical_velocity_command(knights::ChassisSpeeds speeds);
+
+            /**
+             * @brief Drive with the controller relative to the robot
+             * 
+             * @param vert_axis value of the forward/backward joystick axis, from -127 to 127
+             * @param hori_axis value of the right/left joystick axis, right positive, from -127 to 127
+             * @param rot_axis value of the turning joystick axis, right (clockwise) positive, from -127 to 127
+             */
+            void robot_centric_drive(int vert_axis, int hori_axis, int rot_axis);
+
+            /**
+             * @brief Drive with the controller relative to the field. Pushing the joystick forward drives away from the driver
+             *  no matter which way the robot faces, forward being the way the robot faced when the IMU was last reset
+             * 
+             * @param vert_axis value of the forward/backward joystick axis, from -127 to 127
+             * @param hori_axis value of the right/left joystick axis, right positive, from -127 to 127
+             * @param rot_axis value of the turning joystick axis, right (clockwise) positive, from -127 to 127
+             * @param inertial pointer to the IMU to get the heading from
+             */
             void field_centric_drive(int vert_axis, int hori_axis, int rot_axis, pros::Imu* inertial);
-            
+
+            /**
+             * @brief Calculate the maximum velocity of the wheels
+             * 
+             * @return Maximum velocity of a wheel's surface, in inches per second
+             */
+            float max_velocity();
+
+            /**
+             * @brief Calculate the maximum velocity of the robot driving straight forward, faster than the wheels on an X-drive
+             * 
+             * @return Maximum velocity of the robot, in inches per second
+             */
+            float max_translation_velocity();
+
+            /**
+             * @brief Get the measured velocity of the robot, from the motor encoders and the forward kinematics of the wheels
+             * 
+             * @return Velocity of the robot, in inches per second and radians per second (counterclockwise positive)
+             */
+            knights::ChassisSpeeds get_velocity();
     };
 }
 
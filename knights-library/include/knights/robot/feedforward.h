@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef _FEEDFORWARD_H
+#define _FEEDFORWARD_H
+
+// voltage the V5 motors take at full power, in volts
+#define MAX_MOTOR_VOLTAGE 12.0
+
+namespace knights {
+
+    struct Feedforward {
+        float kS = 0.0; // voltage to overcome friction, in volts
+        float kV = 0.0; // voltage per velocity, in volts per inch per second
+        float kA = 0.0; // voltage per acceleration, in volts per inch per second squared
+
+        /**
+         * @brief Construct an empty Feedforward object, with every constant at 0
+         */
+        Feedforward();
+
+        /**
+         * @brief Construct a new Feedforward object, from the constants found with tools/feedforward_fit
+         *
+         * @param kS voltage to overcome friction, in volts
+         * @param kV voltage per velocity, in volts per inch per second
+         * @param kA voltage per acceleration, in volts per inch per second squared
+         */
+        Feedforward(float kS, float kV, float kA);
+
+        /**
+         * @brief Check if the model has been given constants
+         *
+         * @return true if kV is set, the model can't be used without it
+         */
+        bool valid() const;
+
+        /**
+         * @brief Calculate the voltage for a velocity and acceleration, V = kS * sign(v) + kV * v + kA * a
+         *
+         * @param velocity target velocity, in inches per second
+         * @param acceleration target acceleration, in inches per second squared
+         * @return Voltage for the motors, in volts, clamped to the motor's range
+         */
+        float calculate(float velocity, float acceleration = 0.0) const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+
+#ifndef _KINEMATICS_H
+#define _KINEMATICS_H
+
+namespace knights {
+
+    enum holonomic_type {
+        X_DRIVE, // omni wheels at 45 degrees in each corner
+        MECANUM // mecanum wheels facing forward, rollers making an X when looked at from above
+    };
+
+    struct ChassisSpeeds {
+        float forward = 0.0; // velocity along the robot's heading
+        float left = 0.0; // velocity to the robot's left, 90 degrees counterclockwise from its heading
+        float angular = 0.0; // angular velocity, counterclockwise positive (unit circle)
+
+        /**
+         * @brief Construct a new Chassis Speeds object, not moving
+         */
+        ChassisSpeeds();
+
+        /**
+         * @brief Construct a new Chassis Speeds object
+         *
+         * @param forward velocity along the robot's heading
+         * @param left velocity to the robot's left
+         * @param angular angular velocity, counterclockwise positive
+         */
+        ChassisSpeeds(float forward, float left, float angular);
+
+        /**
+         * @brief Turn a velocity on the field into one relative to the robot
+         *
+         * @param x velocity along the field's x axis
+         * @param y velocity along the field's y axis
+         * @param angular angular velocity, counterclockwise positive
+         * @param heading heading of the robot, in radians
+         * @return The velocity relative to the robot
+         */
+        static ChassisSpeeds from_field(float x, float y, float angular, float heading);
+    };
+
+    struct WheelSpeeds {
+        float front_right = 0.0;
+        float front_left = 0.0;
+        float back_right = 0.0;
+        float back_left = 0.0;
+
+        /**
+         * @brief Mix forward, strafe and turn commands into a speed for each wheel,
+         *  the same mix for mecanum and X-drives since both have their wheels' forces at 45 degrees
+         *
+         * @param forward amount to drive forward
+         * @param left amount to strafe left
+         * @param turn amount to turn counterclockwise
+         * @return The speed of each wheel, in the same units as the inputs
+         */
+        static WheelSpeeds mix(float forward, float left, float turn);
+
+        /**
+         * @brief Get the fastest wheel speed
+         *
+         * @return The largest magnitude of the four wheel speeds
+         */
+        float max_magnitude() const;
+
+        /**
+         * @brief Scale every wheel down so none is over a max speed, keeping the ratios between them
+         *  so the robot still drives in the same direction and turns at the same rate relative to it
+         *
+         * @param max fastest a wheel can go
+         */
+        void desaturate(float max);
+    };
+
+    class HolonomicKinematics {
+        private:
+            holonomic_type type; // X-drive or mecanum
+            float track_width; // distance between the right and left wheels
+            float wheel_base; // distance between the front and back wheels
+        public:
+            /**
+             * @brief Construct a new Holonomic Kinematics object
+             *
+             * @param type X-drive or mecanum
+             * @param track_width distance between the right and left wheels, in inches
+             * @param wheel_base distance between the front and back wheels, in inches - 0 to use the track width
+             */
+            HolonomicKinematics(holonomic_type type, float track_width, float wheel_base = 0.0);
+
+            /**
+             * @brief Inverse kinematics, the velocity each wheel needs for the robot to move at a velocity
+             *
+             * @param speeds velocity of the robot, in inches per second and radians per second
+             * @return The velocity of each wheel's surface, in inches per second
+             */
+            WheelSpeeds inverse(ChassisSpeeds speeds) const;
+
+            /**
+             * @brief Forward kinematics, the velocity of the robot from the velocity of its wheels
+             *
+             * @param wheels velocity of each wheel's surface, in inches per second
+             * @return The velocity of the robot, in inches per second and radians per second
+             */
+            ChassisSpeeds forward(WheelSpeeds wheels) const;
+
+            /**
+             * @brief Get how much faster the robot drives forward than its wheels turn,
+             *  sqrt(2) for an X-drive since every wheel pushes at 45 degrees, 1 for mecanum
+             *
+             * @return Robot velocity over wheel velocity when driving straight
+             */
+            float translation_scale() const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,257 @@
+#pragma once
+
+#ifndef _ODOMETRY_H
+#define _ODOMETRY_H
+
+#include "api.h"
+
+#include "knights/autonomous/ekf.h"
+
+#include "knights/robot/sensor_frame.h"
+
+#include "knights/util/calculation.h"
+#include "knights/util/position.h"
+
+#include <cmath>
+
+namespace knights {
+
+    /**
+     * @brief Odometry the chassis can update from, instead of a PositionTrackerGroup
+     */
+    class OdometrySource {
+        public:
+            virtual ~OdometrySource() = default;
+
+            /**
+             * @brief Read every tracking sensor once and move the position by how far the robot went
+             *
+             * @param frame where to write the readings to, for the estimator and logging
+             * @param position the position to move
+             * @param increment where to write the motion relative to the robot, the heading variance is negative if the trackers didn't measure it
+             * @return false if a sensor gave a bad reading, the position wasn't moved
+             */
+            virtual bool update(SensorFrame &frame, Pos &position, MotionIncrement &increment) = 0;
+    };
+
+    // sensors a tracking wheel can be read with, each turns its reading into inches the same way PositionTracker does
+
+    struct Rotation {
+        pros::Rotation *sensor;
+        float inches_per_unit; // centidegrees to inches, with the direction
+
+        /**
+         * @brief Construct a new Rotation object
+         *
+         * @param sensor a pointer to the rotation sensor on the tracking wheel
+         * @param wheel_diameter diameter of the tracking wheel, in inches
+         * @param gear_ratio gear ratio from the sensor to the wheel
+         * @param direction 1 if the sensor counts up going forward, -1 if it counts down
+         */
+        Rotation(pros::Rotation *sensor, float wheel_diameter, float gear_ratio = 1, int direction = 1)
+            : sensor(sensor), inches_per_unit(knights::signum(direction) * wheel_diameter * gear_ratio * M_PI / 36000) {}
+
+        float read() { return this->sensor->get_position() * this->inches_per_unit; }
+    };
+
+    struct AdiEncoder {
+        pros::adi::Encoder *sensor;
+        float inches_per_unit; // degrees to inches, with the direction
+
+        /**
+         * @brief Construct a new Adi Encoder object
+         *
+         * @param sensor a pointer to the triwire encoder on the tracking wheel
+         * @param wheel_diameter diameter of the tracking wheel, in inches
+         * @param gear_ratio gear ratio from the encoder to the wheel
+         * @param direction 1 if the encoder counts up going forward, -1 if it counts down
+         */
+        AdiEncoder(pros::adi::Encoder *sensor, float wheel_diameter, float gear_ratio = 1, int direction = 1)
+            : sensor(sensor), inches_per_unit(knights::signum(direction) * wheel_diameter * gear_ratio * M_PI / 360) {}
+
+        float read() { return this->sensor->get_value() * this->inches_per_unit; }
+    };
+
+    struct MotorEncoder {
+        pros::Motor *sensor;
+        float inches_per_unit; // degrees to inches, with the direction
+
+        /**
+         * @brief Construct a new Motor Encoder object
+         *
+         * @param sensor a pointer to the motor turning the wheel, its encoder set to degrees
+         * @param wheel_diameter diameter of the wheel, in inches
+         * @param gear_ratio gear ratio from the motor to the wheel
+         * @param direction 1 if the motor counts up going forward, -1 if it counts down
+         */
+        MotorEncoder(pros::Motor *sensor, float wheel_diameter, float gear_ratio = 1, int direction = 1)
+            : sensor(sensor), inches_per_unit(knights::signum(direction) * wheel_diameter * gear_ratio * M_PI / 360) {}
+
+        float read() { return this->sensor->get_position() * this->inches_per_unit; }
+    };
+
+    /**
+     * @brief A tracking wheel, remembers its last reading to give how far it went since
+     *
+     * @tparam Sensor the sensor type, Rotation, AdiEncoder or MotorEncoder
+     */
+    template <typename Sensor>
+    struct TrackingWheel {
+        Sensor sensor;
+        float offset; // distance from the tracking center, which side is given by the wheel's role
+        float previous = 0.0; // distance at the last update, in inches
+
+        TrackingWheel(Sensor sensor, float offset) : sensor(sensor), offset(offset) {}
+
+        /**
+         * @brief Read the sensor once
+         *
+         * @param reading where to write the distance the wheel has travelled to
+         * @return Distance travelled since the last update, in inches
+         */
+        float delta(float &reading) {
+            reading = this->sensor.read();
+            float delta = reading - this->previous;
+            this->previous = reading;
+            return delta;
+        }
+    };
+
+    /**
+     * @brief Tracking wheel facing forward, offset is its distance to the right of the tracking center
+     */
+    template <typename Sensor>
+    struct Vertical : TrackingWheel<Sensor> {
+        Vertical(Sensor sensor, float offset = 0.0) : TrackingWheel<Sensor>(sensor, offset) {}
+    };
+
+    /**
+     * @brief Tracking wheel facing sideways, offset is its distance behind the tracking center
+     */
+    template <typename Sensor>
+    struct Horizontal : TrackingWheel<Sensor> {
+        Horizontal(Sensor sensor, float offset = 0.0) : TrackingWheel<Sensor>(sensor, offset) {}
+    };
+
+    /**
+     * @brief No horizontal tracking wheel, the robot is taken to not slide sideways
+     */
+    struct NoHorizontal {
+        float offset = 0.0;
+
+        float delta(float &reading) { return 0.0; }
+    };
+
+    // where the heading comes from, the odometry picks the math for each at compile time
+
+    /**
+     * @brief Heading from an IMU
+     */
+    struct Imu {
+        static constexpr bool parallel = false;
+        pros::IMU *sensor;
+        float previous = NAN; // heading at the last good reading, in radians counterclockwise
+
+        /**
+         * @brief Construct a new Imu object
+         *
+         * @param sensor a pointer to the inertial sensor
+         */
+        Imu(pros::IMU *sensor) : sensor(sensor) {}
+
+        /**
+         * @brief Read the sensor once. Only the change is used, so the chassis heading doesn't have to match the IMU's
+         *
+         * @param reading where to write the heading of the IMU to, in degrees clockwise like the IMU reports it
+         * @return Angle turned since the last update, in radians counterclockwise - 0 on the first reading
+         */
+        float delta(float &reading) {
+            reading = this->sensor->get_heading();
+            float heading = knights::to_rad(-reading);
+            float delta = std::isnan(this->previous) ? 0 : knights::min_angle(this->previous, heading, true);
+            // a bad reading isn't kept, the next good one gives the turn over both updates
+            if (std::isfinite(heading))
+                this->previous = heading;
+            return delta;
+        }
+    };
+
+    /**
+     * @brief Heading from a second vertical tracking wheel on the other side, offset is its distance to the left of the tracking center
+     */
+    template <typename Sensor>
+    struct Parallel : TrackingWheel<Sensor> {
+        static constexpr bool parallel = true;
+
+        Parallel(Sensor sensor, float offset) : TrackingWheel<Sensor>(sensor, offset) {}
+    };
+
+    /**
+     * @brief Odometry for a tracker configuration known at compile time, e.g. Odometry<Vertical<Rotation>, Horizontal<Rotation>, Imu>.
+     *  Every sensor is read directly and the update is one straight run with no checks for which trackers exist
+     *
+     * @tparam VerticalWheel the forward facing tracking wheel, Vertical<Sensor>
+     * @tparam HorizontalWheel the sideways tracking wheel, Horizontal<Sensor> or NoHorizontal
+     * @tparam Heading where the heading comes from, Imu or Parallel<Sensor>
+     */
+    template <typename VerticalWheel, typename HorizontalWheel, typename Heading>
+    class Odometry final : public OdometrySource {
+        private:
+            VerticalWheel vertical;
+            HorizontalWheel horizontal;
+            Heading heading;
+        public:
+            /**
+             * @brief Construct a new Odometry object
+             *
+             * @param vertical the forward facing tracking wheel
+             * @param horizontal the sideways tracking wheel
+             * @param heading where the heading comes from
+             */
+            Odometry(VerticalWheel vertical, HorizontalWheel horizontal, Heading heading)
+                : vertical(vertical), horizontal(horizontal), heading(heading) {}
+
+            bool update(SensorFrame &frame, Pos &position, MotionIncrement &increment) override {
+                float forward = this->vertical.delta(frame.right);
+                float lateral = this->horizontal.delta(frame.back);
+                float turn; // counterclockwise
+
+                if constexpr (Heading::parallel) {
+                    float other = this->heading.delta(frame.left);
+                    float width = this->vertical.offset + this->heading.offset;
+                    turn = (forward - other) / width;
+                    // the tracking center moves the weighted average of the two
+                    forward = (forward * this->heading.offset + other * this->vertical.offset) / width;
+                    increment.heading_variance = 0.0;
+                } else {
+                    turn = this->heading.delta(frame.imu_heading);
+                    frame.imu_rate = this->heading.sensor->get_gyro_rate().z;
+                    // a wheel off the tracking center moves when the robot turns in place
+                    forward -= this->vertical.offset * turn;
+                }
+                if (!std::isfinite(turn))
+                    return false;
+                lateral += this->horizontal.offset * turn;
+
+                // along the arc the robot drove, the chord is shorter than the distance the wheels rolled
+                if (turn != 0) {
+                    float chord = 2 * sin(turn / 2) / turn;
+                    forward *= chord;
+                    lateral *= chord;
+                }
+
+                float average_heading = position.heading + turn / 2;
+                position.x += forward * cos(average_heading) - lateral * sin(average_heading);
+                position.y += forward * sin(average_heading) + lateral * cos(average_heading);
+                position.heading = knights::normalize_angle(position.heading + turn, true);
+
+                increment.forward = forward;
+                increment.lateral = lateral;
+                increment.heading = turn;
+                return true;
+            }
+    };
+
+}
+
+#endif
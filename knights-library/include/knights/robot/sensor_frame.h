@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef _SENSOR_FRAME_H
+#define _SENSOR_FRAME_H
+
+#include "knights/robot/kinematics.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace knights {
+
+    /**
+     * @brief Every reading the chassis uses, taken once at the start of an odometry update.
+     *  Odometry, the estimator, movements and logging all use the same frame, so each sensor is only read once per update
+     *  and they can't disagree with each other. Readings from sensors the robot doesn't have are NAN
+     */
+    struct SensorFrame {
+        std::uint32_t time = 0; // when the sensors were read, in milliseconds since the program started (pros::millis())
+
+        // distance travelled by each tracking wheel, in inches
+        float right = NAN;
+        float left = NAN;
+        float front = NAN;
+        float back = NAN;
+
+        float imu_heading = NAN; // heading of the IMU, in degrees clockwise like the IMU reports it
+        float imu_rate = NAN; // rate of the IMU around its z axis, in degrees per second
+
+        // velocity of each side of a differential drive, in inches per second
+        float right_velocity = NAN;
+        float left_velocity = NAN;
+
+        knights::ChassisSpeeds drive_velocity; // velocity of the drivetrain relative to the robot, from its motors
+    };
+
+}
+
+#endif
@@ -38,6 +38,15 @@ namespace knights {
     */
     float min_angle(float start, float target, bool rad = true);
 
+    /**
+    @brief move an angle by full turns so it is as close as possible to a reference, keeps an angle continuous between loops
+    @param angle the angle to move
+    @param reference the angle to stay close to
+    @param rad whether or not the angles are in radians (if false, they are in degrees)
+    @return the angle plus or minus full turns, within half a turn of the reference
+    */
+    float unwrap_angle(float angle, float reference, bool rad = true);
+
     /**
      * @brief Get angular error between two angles
      * 
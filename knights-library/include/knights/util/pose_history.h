@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef _POSE_HISTORY_H
+#define _POSE_HISTORY_H
+
+#include "knights/util/position.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// amount of poses kept by default, 2 seconds at the default odometry period
+#define POSE_HISTORY_SIZE 200
+
+namespace knights {
+
+    struct PoseSample {
+        Pos pose; // position of the robot, heading in radians
+        float velocity_x = 0.0; // velocity along the field's x axis, in inches per second
+        float velocity_y = 0.0; // velocity along the field's y axis, in inches per second
+        float angular_velocity = 0.0; // angular velocity, in radians per second counterclockwise
+        std::uint32_t time = 0; // time the pose was measured at, in milliseconds since the program started
+    };
+
+    class PoseHistory {
+        private:
+            struct Slot {
+                std::atomic<std::uint32_t> sequence = 0; // odd while the sample is being written
+                PoseSample sample;
+            };
+
+            std::vector<Slot> slots;
+            std::atomic<std::uint32_t> count = 0; // amount of samples ever pushed, the newest is at (count - 1) % size
+
+            /**
+             * @brief Copy a slot, retrying if the writer changes it during the copy
+             *
+             * @param index index of the sample, in amount of samples ever pushed
+             * @param sample where to copy the sample to
+             * @return false if the sample has been overwritten by a newer one
+             */
+            bool read(std::uint32_t index, PoseSample &sample) const;
+        public:
+            /**
+             * @brief Construct a new Pose History object
+             *
+             * @param capacity amount of poses to keep, the oldest is overwritten once it is full
+             */
+            PoseHistory(int capacity = POSE_HISTORY_SIZE);
+
+            /**
+             * @brief Add the newest pose. Only one task can push, but any amount can read at the same time without locking
+             *
+             * @param sample pose to add, its time has to be after the last pose's
+             */
+            void push(const PoseSample &sample);
+
+            /**
+             * @brief Remove every pose
+             */
+            void clear();
+
+            /**
+             * @brief Get the amount of poses stored
+             *
+             * @return Amount of poses that can be read, up to the capacity
+             */
+            int size() const;
+
+            /**
+             * @brief Get the newest pose
+             *
+             * @param sample where to copy the pose to
+             * @return false if there are no poses
+             */
+            bool latest(PoseSample &sample) const;
+
+            /**
+             * @brief Get the pose at a past time, interpolated between the poses measured before and after it.
+             *  Times after the newest pose give the newest pose
+             *
+             * @param time time to get the pose at, in milliseconds since the program started
+             * @param sample where to copy the pose to
+             * @return false if there are no poses, or the time is older than the oldest one kept
+             */
+            bool at(std::uint32_t time, PoseSample &sample) const;
+    };
+
+}
+
+#endif
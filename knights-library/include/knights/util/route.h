@@ -0,0 +1,186 @@
+#pragma once
+
+#ifndef _ROUTE_H
+#define _ROUTE_H
+
+#include <string>
+#include <vector>
+
+#include "knights/util/position.h"
+
+namespace knights {
+
+    struct RouteProgress {
+        int segment = 0; // index of the segment the robot is on, from position segment to position segment+1
+        float t = 0.0; // how far along the segment the robot is [0,1]
+        float distance = 0.0; // distance along the route from the first position
+        Pos point; // the point on the route that the robot is projected onto
+    };
+
+    struct RouteMarker {
+        float position = 0.0; // where on the route the marker is, in inches or as a fraction of the route
+        bool fraction = false; // whether the position is a fraction [0,1] of the route instead of a distance
+        std::string function_name; // name of the function in the autonomous input map to run
+
+        /**
+         * @brief Construct a new Route Marker object
+         * 
+         * @param position where on the route the marker is, in inches or as a fraction of the route
+         * @param fraction whether the position is a fraction [0,1] of the route instead of a distance
+         * @param function_name name of the function in the autonomous input map to run
+         */
+        RouteMarker(float position, bool fraction, std::string function_name);
+
+        /**
+         * @brief Construct a new Route Marker object at the start of the route with no function
+         */
+        RouteMarker();
+
+        /**
+         * @brief Get the distance along a route the marker is at
+         * 
+         * @param length total length of the route
+         * @return Distance from the start of the route, in inches
+         */
+        float distance_along(float length) const;
+    };
+
+    struct Route {
+        std::vector<Pos> positions;
+        std::vector<RouteMarker> markers; // functions to run as the robot passes points on the route
+
+        // geometry of the route, built once by compute_geometry() so followers don't redo it every loop
+        std::vector<float> arc_lengths; // distance along the route from the first position to each position
+        std::vector<float> curvatures; // signed curvature at each position, positive when the route turns left
+        std::vector<float> segment_lengths; // length of the segment from position i to position i+1
+        std::vector<Point> segment_directions; // unit vector pointing from position i to position i+1
+
+        /**
+         * @brief Construct a new Route object
+         * 
+         * @param positions A vector of positions for the route, this can be read out of a file or inputted manually
+         */
+        Route(std::vector<Pos> positions);
+
+        /**
+         * @brief Construct a new Route object with an empty position vector
+         * 
+         */
+        Route();
+
+        /**
+         * @brief Rebuild the geometry cache (arc lengths, curvatures, segment lengths and directions) from the positions.
+         * 
+         *  Has to be called again if the positions vector is edited directly.
+         * 
+         */
+        void compute_geometry();
+
+        /**
+         * @brief Whether the geometry cache matches the current positions
+         * 
+         * @return true if compute_geometry() does not need to be called
+         */
+        bool geometry_valid() const;
+
+        /**
+         * @brief Get the total length of the route
+         * 
+         * @return Distance from the first position to the last position, along the route
+         */
+        float length_dist();
+
+        /**
+         * @brief Get the cached signed curvature at a position, the index is clamped to the route
+         * 
+         * @param i index of the position
+         * @return 1 / radius of the turn at the position, positive for left and negative for right
+         */
+        float curvature_at(int i) const;
+
+        /**
+         * @brief Get the cached signed curvature at a point on the route, interpolated between the positions around it
+         * 
+         * @param progress point on the route
+         * @return 1 / radius of the turn at the point, positive for left and negative for right
+         */
+        float curvature_at(const RouteProgress &progress) const;
+
+        /**
+         * @brief Project a position onto the route, only searching a few segments ahead of the previous projection.
+         * 
+         *  The returned progress never moves backwards along the route, so a route that loops back near itself
+         *  can't pull the projection ahead or behind. The cost doesn't depend on the length of the route.
+         * 
+         * @param position position to project onto the route
+         * @param previous projection from the last time this was called, or a default RouteProgress to start at the beginning
+         * @param window amount of segments ahead of the previous projection to search
+         * @return The closest point on the searched segments
+         */
+        RouteProgress project(const Pos &position, const RouteProgress &previous, int window = 10) const;
+
+        /**
+         * @brief Find the lookahead point, the first point past the start where the route leaves a circle around the robot.
+         * 
+         *  The search starts on the segment of the start progress and stops at the first intersection, so later
+         *  parts of the route that happen to cross the circle are never picked. Pass the result back in as the start
+         *  on the next loop (or the robot's projection, whichever is further along) to resume from where it left off.
+         * 
+         * @param position center of the circle, the robot's position
+         * @param lookahead_distance radius of the circle
+         * @param start point on the route to start searching from
+         * @return The lookahead point, the end of the route if it is inside the circle, or the start if nothing was found
+         */
+        RouteProgress lookahead(const Pos &position, float lookahead_distance, const RouteProgress &start) const;
+
+    };
+
+    /**
+     * @brief Append one route to another, the markers of the second route are moved to where it now starts
+     * 
+     * @param r1 the route to append to
+     * @param r2 the route to append
+     * @return Route 
+     */
+    Route operator+(const Route &r1, const Route &r2);
+
+    /**
+     * @brief Add a position to a route
+     * 
+     * @param r1 the route to add to
+     * @param p1 the position to add
+     * @return Route 
+     */
+    Route operator+(Route r1, const Pos &p1);
+
+    /**
+     * @brief Remove a number of positions from the end of a route
+     * 
+     * @param r1 the route to remove positions from
+     * @param amt the amount of poitions to remove
+     * @return Route 
+     */
+    Route operator-(Route r1, const int &amt);
+
+    /**
+     * @brief Resample a route so its positions are evenly spaced along it, the markers are kept
+     * 
+     * @param route the route to resample
+     * @param spacing distance between each position
+     * @return Route with a position every spacing inches, plus the last position
+     */
+    Route resample_route(const Route &route, float spacing);
+
+    /**
+     * @brief Smooth the corners of a route, keeping the first and last positions and the markers in place
+     * 
+     * @param route the route to smooth
+     * @param weight_data how much each position is pulled back to where it started
+     * @param weight_smooth how much each position is pulled towards its neighbours
+     * @param tolerance stop once the positions move less than this in one pass
+     * @return The smoothed route
+     */
+    Route smooth_route(const Route &route, float weight_data = 0.25, float weight_smooth = 0.75, float tolerance = 0.001);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#ifndef _SEQLOCK_H
+#define _SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace knights {
+
+    /**
+     * @brief A value shared between tasks that readers copy without locking or waiting on the writer.
+     *
+     *  Two copies are kept and the writer updates one at a time, bumping the sequence before each, so there is always
+     *  a whole copy for readers to take. A reader only retries if the writer finished a copy while it was reading, so a reader
+     *  that interrupts the writer never spins waiting for it. Only one task can write at a time.
+     *
+     * @tparam T type of the value, has to be trivially copyable
+     */
+    template <typename T>
+    class SeqLock {
+        static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied while they might be written");
+
+        private:
+            std::atomic<std::uint32_t> sequence = 0; // bumped twice per write, the low bit is which copy readers use
+            T copies[2];
+        public:
+            /**
+             * @brief Construct a new SeqLock object
+             *
+             * @param value value readers get before the first write
+             */
+            SeqLock(const T &value = T()) {
+                this->copies[0] = value;
+                this->copies[1] = value;
+            }
+
+            /**
+             * @brief Publish a new value, without blocking readers. Writers have to take turns
+             *
+             * @param value value to publish
+             */
+            void write(const T &value) {
+                std::uint32_t sequence = this->sequence.load(std::memory_order_relaxed);
+
+                // odd, readers take the second copy while the first is written
+                this->sequence.store(sequence + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                this->copies[0] = value;
+
+                // even, readers take the first copy while the second is written
+                std::atomic_thread_fence(std::memory_order_release);
+                this->sequence.store(sequence + 2, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                this->copies[1] = value;
+            }
+
+            /**
+             * @brief Copy the newest whole value
+             *
+             * @param value where to copy the value to
+             * @return Generation of the value, the amount of writes before it - changes every time a new value is published
+             */
+            std::uint32_t read(T &value) const {
+                while (true) {
+                    std::uint32_t before = this->sequence.load(std::memory_order_acquire);
+                    value = this->copies[before & 1];
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (this->sequence.load(std::memory_order_relaxed) == before)
+                        return before / 2;
+                }
+            }
+
+            /**
+             * @brief Get the generation of the newest value without copying it
+             *
+             * @return Amount of writes that have finished
+             */
+            std::uint32_t generation() const {
+                return this->sequence.load(std::memory_order_acquire) / 2;
+            }
+    };
+
+}
+
+#endif
@@ -2,45 +2,167 @@
 #include "knights/autonomous/pid.h"
 #include "knights/autonomous/ramsete.h"
 
+#include "knights/driver/input.h"
 #include "knights/robot/chassis.h"
 
 #include "knights/util/calculation.h"
+#include "knights/util/timer.h"
 
-knights::PIDController::PIDController(float kP, float kI, float kD) 
-    : kP(kP), kI(kI), kD(kD), min_velocity(0.0), max_velocity(127.0) {
+#include "pros/rtos.hpp"
+
+#include <cmath>
+
+knights::RamseteConstants::RamseteConstants(const float &damping, const float &proportional)
+    : damping(damping), proportional(proportional) {
 }
 
-knights::PIDController::PIDController(float kP, float kI, float kD, float min_velocity, float max_velocity) 
-    : kP(kP), kI(kI), kD(kD), min_velocity(min_velocity), max_velocity(max_velocity) {
+knights::RobotController::RobotController(RobotChassis *chassis, PIDController *pid_controller, RamseteConstants *ramsete_constants, bool use_motor_encoders)
+    : chassis(chassis), pid_controller(pid_controller), ramsete_constants(ramsete_constants), use_motor_encoders(use_motor_encoders) {
 }
 
-knights::PIDController::PIDController() 
-    : kP(0.0), kI(0.0), kD(0.0), min_velocity(0.0), max_velocity(127.0) {
+knights::RobotController::RobotController(RobotChassis *chassis, PIDController *pid_controller, bool use_motor_encoders)
+    : chassis(chassis), pid_controller(pid_controller), use_motor_encoders(use_motor_encoders) {
 }
 
-float knights::PIDController::update(float error, float total_error, float prev_error) {
-    return knights::clamp(this->kP * error + this->kI * total_error + this->kD * (error - prev_error), this->min_velocity, this->max_velocity);
+knights::RobotController::~RobotController() {
+    // an async movement still running would use this controller after it is gone
+    while (this->is_in_motion()) {
+        this->cancel();
+        pros::delay(10);
+    }
 }
 
-float knights::PIDController::get_max_speed() {
-    return std::fabs(this->max_velocity);
+void knights::RobotController::set_input_map(input::AutonomousInputMap *input_map) {
+    this->input_map = input_map;
 }
 
-float knights::PIDController::get_min_speed() {
-    return std::fabs(this->min_velocity);
+bool knights::RobotController::not_arrived(const Pos &desired_position, float end_tolerance) {
+    Pos position, prev_position;
+    this->chassis->get_positions(position, prev_position);
+
+    float error = knights::distance_btwn(position, desired_position);
+    return error > end_tolerance || knights::distance_btwn(prev_position, desired_position) < error;
 }
 
+void knights::RobotController::set_angular_pid(PIDController *angular_pid_controller) {
+    this->angular_pid_controller = angular_pid_controller;
+}
 
-knights::RamseteConstants::RamseteConstants(const float &damping, const float &proportional)
-    : damping(damping), proportional(proportional) {
+void knights::RobotController::fire_markers(const std::vector<RouteMarker> &markers, std::vector<bool> &fired, float distance, float length) {
+    if (this->input_map == nullptr)
+        return;
+
+    for (int i = 0; i < markers.size(); i++) {
+        if (!fired[i] && distance >= markers[i].distance_along(length)) {
+            fired[i] = true;
+            this->input_map->execute_action(markers[i].function_name);
+        }
+    }
 }
 
-knights::RobotController::RobotController(RobotChassis *chassis, PIDController *pid_controller, RamseteConstants *ramsete_constants, bool use_motor_encoders)
-    : chassis(chassis), pid_controller(pid_controller), ramsete_constants(ramsete_constants), use_motor_encoders(use_motor_encoders) {
+void knights::RobotController::run_async(std::function<void()> motion) {
+    // only one async movement at a time, so wait for the current one
+    this->wait_until_done();
+
+    int id = ++this->motion_count;
+    this->queued_motion = id;
+
+    pros::Task motion_task([this, motion, id]() {
+        motion();
+
+        // clear the queued id if the movement returned without starting
+        int expected = id;
+        this->queued_motion.compare_exchange_strong(expected, 0);
+    }, "motion");
 }
 
-knights::RobotController::RobotController(RobotChassis *chassis, PIDController *pid_controller, bool use_motor_encoders)
-    : chassis(chassis), pid_controller(pid_controller), use_motor_encoders(use_motor_encoders) {
+void knights::RobotController::start_motion() {
+    this->motion_mutex.take(TIMEOUT_MAX);
+
+    // a cancel that came in while this movement was queued ends it as soon as it starts
+    int id = this->queued_motion;
+    this->cancel_requested = id != 0 && this->cancelled_motion == id;
+    this->motion_distance = 0.0;
+    this->motion_progress = 0.0;
+    this->in_motion = true;
+    this->queued_motion = 0;
+
+    // checked again, cancel() could have seen the movement queued before in_motion was set
+    if (id != 0 && this->cancelled_motion == id)
+        this->cancel_requested = true;
+}
+
+void knights::RobotController::end_motion() {
+    this->motion_progress = 1.0;
+    this->in_motion = false;
+    this->motion_mutex.give();
+}
+
+void knights::RobotController::update_progress(float distance, float progress) {
+    this->motion_distance = distance;
+    this->motion_progress = knights::clamp(progress, 0.0f, 1.0f);
+}
+
+void knights::RobotController::wait_until_done() {
+    while (this->in_motion || this->queued_motion != 0)
+        pros::delay(10);
+}
+
+void knights::RobotController::wait_until(float distance) {
+    // an async movement might not have started yet
+    while (this->queued_motion != 0)
+        pros::delay(10);
+
+    while (this->in_motion && this->motion_distance < distance)
+        pros::delay(10);
+}
+
+void knights::RobotController::wait_until_progress(float progress) {
+    while (this->queued_motion != 0)
+        pros::delay(10);
+
+    while (this->in_motion && this->motion_progress < progress)
+        pros::delay(10);
+}
+
+void knights::RobotController::cancel() {
+    // an async movement that hasn't started yet is remembered, start_motion() would clear the flag
+    int queued = this->queued_motion;
+    if (queued != 0)
+        this->cancelled_motion = queued;
+
+    if (this->in_motion)
+        this->cancel_requested = true;
+}
+
+bool knights::RobotController::is_in_motion() {
+    return this->in_motion || this->queued_motion != 0;
+}
+
+void knights::RobotController::wait_until_settled(float settle_velocity, float timeout) {
+    knights::Timer timer;
+
+    if (this->chassis->holonomic != nullptr) {
+        // the translation speed, and how fast the wheels move to turn the robot
+        knights::Holonomic *holonomic = this->chassis->holonomic;
+        while (timer.get() < timeout) {
+            knights::ChassisSpeeds speeds = this->chassis->get_measured_velocity();
+            if (std::fmax(std::hypot(speeds.forward, speeds.left), std::fabs(speeds.angular * holonomic->track_width / 2)) <= settle_velocity)
+                break;
+            pros::delay(10);
+        }
+        return;
+    }
+
+    if (this->chassis->drivetrain == nullptr) return;
+
+    // speed of the faster side
+    while (timer.get() < timeout) {
+        knights::ChassisSpeeds speeds = this->chassis->get_measured_velocity();
+        if (std::fabs(speeds.forward) + std::fabs(speeds.angular * this->chassis->drivetrain->track_width / 2) <= settle_velocity)
+            break;
+        pros::delay(10);
+    }
 }
 
 
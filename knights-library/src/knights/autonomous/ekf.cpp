@@ -0,0 +1,151 @@
+#include "knights/autonomous/ekf.h"
+#include "knights/util/calculation.h"
+
+#include <cmath>
+
+knights::MotionIncrement knights::MotionIncrement::fuse(const knights::MotionIncrement *increments, int amount) {
+    // weighted sum of each part and the sum of the weights, the fused variance is one over the sum of the weights
+    float sums[3] = {0, 0, 0}, weights[3] = {0, 0, 0};
+
+    for (int i = 0; i < amount; i++) {
+        const MotionIncrement &increment = increments[i];
+        float values[3] = {increment.forward, increment.lateral, increment.heading};
+        float variances[3] = {increment.forward_variance, increment.lateral_variance, increment.heading_variance};
+
+        for (int part = 0; part < 3; part++) {
+            if (variances[part] <= 0)
+                continue;
+            sums[part] += values[part] / variances[part];
+            weights[part] += 1 / variances[part];
+        }
+    }
+
+    MotionIncrement fused;
+    float *values[3] = {&fused.forward, &fused.lateral, &fused.heading};
+    float *variances[3] = {&fused.forward_variance, &fused.lateral_variance, &fused.heading_variance};
+    for (int part = 0; part < 3; part++) {
+        if (weights[part] <= 0)
+            continue;
+        *values[part] = sums[part] / weights[part];
+        *variances[part] = 1 / weights[part];
+    }
+
+    return fused;
+}
+
+knights::PoseEKF::PoseEKF(knights::EKFNoise noise) : noise(noise) {}
+
+void knights::PoseEKF::reset(knights::Pos pose, float position_variance, float heading_variance) {
+    this->state[0] = pose.x;
+    this->state[1] = pose.y;
+    this->state[2] = knights::normalize_angle(pose.heading, true);
+
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            this->covariance[r][c] = 0;
+    this->covariance[0][0] = position_variance;
+    this->covariance[1][1] = position_variance;
+    this->covariance[2][2] = heading_variance;
+}
+
+const knights::EKFNoise &knights::PoseEKF::get_noise() const {
+    return this->noise;
+}
+
+void knights::PoseEKF::predict(knights::MotionIncrement increment) {
+    float minimum = this->noise.minimum_variance;
+    float forward = (increment.forward_variance > 0) ? increment.forward : 0;
+    float lateral = (increment.lateral_variance > 0) ? increment.lateral : 0;
+    float turn = (increment.heading_variance > 0) ? increment.heading : 0;
+    float input_variance[3] = {std::fmax(increment.forward_variance, minimum), std::fmax(increment.lateral_variance, minimum),
+        std::fmax(increment.heading_variance, minimum)};
+
+    // move along the average heading over the increment
+    float heading = this->state[2] + turn / 2;
+    float c = cos(heading), s = sin(heading);
+    float dx = forward * c - lateral * s;
+    float dy = forward * s + lateral * c;
+
+    this->state[0] += dx;
+    this->state[1] += dy;
+    this->state[2] = knights::normalize_angle(this->state[2] + turn, true);
+
+    // jacobians of the motion by the state (F) and by the increment (G)
+    float F[3][3] = {{1, 0, -dy}, {0, 1, dx}, {0, 0, 1}};
+    float G[3][3] = {{c, -s, -dy / 2}, {s, c, dx / 2}, {0, 0, 1}};
+
+    // P = F P F^T + G Q G^T, with Q diagonal
+    float FP[3][3], next[3][3];
+    for (int r = 0; r < 3; r++)
+        for (int k = 0; k < 3; k++) {
+            FP[r][k] = 0;
+            for (int m = 0; m < 3; m++)
+                FP[r][k] += F[r][m] * this->covariance[m][k];
+        }
+    for (int r = 0; r < 3; r++)
+        for (int k = 0; k < 3; k++) {
+            next[r][k] = 0;
+            for (int m = 0; m < 3; m++)
+                next[r][k] += FP[r][m] * F[k][m] + G[r][m] * input_variance[m] * G[k][m];
+        }
+
+    for (int r = 0; r < 3; r++)
+        for (int k = 0; k < 3; k++)
+            this->covariance[r][k] = next[r][k];
+}
+
+void knights::PoseEKF::update_heading(float heading, float variance) {
+    // the innovation the short way around, so crossing 0 doesn't look like a full turn
+    float innovation = knights::min_angle(this->state[2], heading, true);
+    float innovation_variance = this->covariance[2][2] + variance;
+    if (innovation_variance <= 0)
+        return;
+
+    float gain[3];
+    for (int r = 0; r < 3; r++)
+        gain[r] = this->covariance[r][2] / innovation_variance;
+
+    this->state[0] += gain[0] * innovation;
+    this->state[1] += gain[1] * innovation;
+    this->state[2] = knights::normalize_angle(this->state[2] + gain[2] * innovation, true);
+
+    // P = (I - K H) P, H only picks the heading
+    float heading_row[3] = {this->covariance[2][0], this->covariance[2][1], this->covariance[2][2]};
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            this->covariance[r][c] -= gain[r] * heading_row[c];
+}
+
+void knights::PoseEKF::update_position(float x, float y, float variance) {
+    // x and y one after the other, the measurement noise of each is independent
+    float measurements[2] = {x, y};
+    for (int axis = 0; axis < 2; axis++) {
+        float innovation_variance = this->covariance[axis][axis] + variance;
+        if (innovation_variance <= 0)
+            continue;
+
+        float innovation = measurements[axis] - this->state[axis];
+        float gain[3];
+        for (int r = 0; r < 3; r++)
+            gain[r] = this->covariance[r][axis] / innovation_variance;
+
+        this->state[0] += gain[0] * innovation;
+        this->state[1] += gain[1] * innovation;
+        this->state[2] = knights::normalize_angle(this->state[2] + gain[2] * innovation, true);
+
+        float row[3] = {this->covariance[axis][0], this->covariance[axis][1], this->covariance[axis][2]};
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                this->covariance[r][c] -= gain[r] * row[c];
+    }
+}
+
+knights::Pos knights::PoseEKF::get_pose() const {
+    return Pos(this->state[0], this->state[1], this->state[2]);
+}
+
+void knights::PoseEKF::get_covariance(float covariance[3][3]) const {
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            covariance[r][c] = this->covariance[r][c];
+}
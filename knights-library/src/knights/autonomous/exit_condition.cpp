@@ -0,0 +1,77 @@
+#include "knights/autonomous/exit_condition.h"
+
+#include <cmath>
+
+knights::ExitCondition::ExitCondition() {
+}
+
+knights::ExitCondition::ExitCondition(float small_error, float small_time, float large_error, float large_time, float timeout)
+    : small_error(small_error), small_time(small_time), large_error(large_error), large_time(large_time), timeout(timeout) {
+}
+
+void knights::ExitCondition::set_small_error(float error, float time) {
+    this->small_error = error;
+    this->small_time = time;
+}
+
+void knights::ExitCondition::set_large_error(float error, float time) {
+    this->large_error = error;
+    this->large_time = time;
+}
+
+void knights::ExitCondition::set_stall(float velocity, float time) {
+    this->stall_velocity = velocity;
+    this->stall_time = time;
+}
+
+void knights::ExitCondition::set_timeout(float timeout) {
+    this->timeout = timeout;
+}
+
+bool knights::ExitCondition::enabled() const {
+    return this->small_error >= 0 || this->large_error >= 0 || this->stall_velocity >= 0 || this->timeout >= 0;
+}
+
+void knights::ExitCondition::reset() {
+    this->start_time = -1.0;
+    this->small_start = -1.0;
+    this->large_start = -1.0;
+    this->stall_start = -1.0;
+    this->moving = false;
+    this->reason = NOT_EXITED;
+}
+
+bool knights::ExitCondition::held(bool inside, float &entered, float hold, float time) {
+    // leaving the window starts the hold over
+    if (!inside) {
+        entered = -1.0;
+        return false;
+    }
+
+    if (entered < 0)
+        entered = time;
+
+    return time - entered >= hold;
+}
+
+bool knights::ExitCondition::update(float error, float velocity, float time) {
+    if (this->start_time < 0)
+        this->start_time = time;
+    if (std::fabs(velocity) > this->stall_velocity)
+        this->moving = true;
+
+    if (this->small_error >= 0 && held(std::fabs(error) <= this->small_error, this->small_start, this->small_time, time))
+        this->reason = SMALL_ERROR;
+    else if (this->large_error >= 0 && held(std::fabs(error) <= this->large_error, this->large_start, this->large_time, time))
+        this->reason = LARGE_ERROR;
+    else if (this->stall_velocity >= 0 && this->moving && held(std::fabs(velocity) <= this->stall_velocity, this->stall_start, this->stall_time, time))
+        this->reason = STALLED;
+    else if (this->timeout >= 0 && time - this->start_time >= this->timeout)
+        this->reason = TIMED_OUT;
+
+    return this->reason != NOT_EXITED;
+}
+
+knights::exit_reason knights::ExitCondition::get_reason() const {
+    return this->reason;
+}
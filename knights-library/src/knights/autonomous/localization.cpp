@@ -0,0 +1,252 @@
+#include "knights/autonomous/localization.h"
+#include "knights/util/calculation.h"
+
+#include <cmath>
+
+void knights::FieldMap::add_segment(float x1, float y1, float x2, float y2) {
+    this->start_x.push_back(x1);
+    this->start_y.push_back(y1);
+    this->end_x.push_back(x2);
+    this->end_y.push_back(y2);
+}
+
+void knights::FieldMap::add_box(float min_x, float min_y, float max_x, float max_y) {
+    this->add_segment(min_x, min_y, max_x, min_y);
+    this->add_segment(max_x, min_y, max_x, max_y);
+    this->add_segment(max_x, max_y, min_x, max_y);
+    this->add_segment(min_x, max_y, min_x, min_y);
+}
+
+knights::FieldMap knights::FieldMap::perimeter(float width) {
+    FieldMap map;
+    map.add_box(0, 0, width, width);
+    return map;
+}
+
+int knights::FieldMap::size() const {
+    return this->start_x.size();
+}
+
+float knights::FieldMap::ray_cast(float x, float y, float angle, float max_range) const {
+    float cos_angle = cos(angle), sin_angle = sin(angle), distance;
+    this->ray_cast(&x, &y, &cos_angle, &sin_angle, 1, max_range, &distance);
+    return distance;
+}
+
+void knights::FieldMap::ray_cast(const float *x, const float *y, const float *cos_angle, const float *sin_angle, int amount, float max_range,
+    float *distances) const {
+    for (int i = 0; i < amount; i++)
+        distances[i] = max_range;
+
+    // one wall at a time over every ray, the inner loop has no branches so it vectorizes
+    for (int segment = 0; segment < this->size(); segment++) {
+        float start_x = this->start_x[segment], start_y = this->start_y[segment];
+        float length_x = this->end_x[segment] - start_x, length_y = this->end_y[segment] - start_y;
+
+        for (int i = 0; i < amount; i++) {
+            // solve ray start + t * ray direction = wall start + u * wall length
+            float denominator = cos_angle[i] * length_y - sin_angle[i] * length_x;
+            float offset_x = start_x - x[i], offset_y = start_y - y[i];
+            float t = (offset_x * length_y - offset_y * length_x) / denominator;
+            float u = (offset_x * sin_angle[i] - offset_y * cos_angle[i]) / denominator;
+
+            // bitwise ands so there's no branch, a parallel wall divides by 0 and fails the checks
+            bool hit = (denominator != 0) & (t >= 0) & (u >= 0) & (u <= 1);
+            float distance = hit ? t : max_range;
+            distances[i] = (distance < distances[i]) ? distance : distances[i];
+        }
+    }
+}
+
+knights::BeamSensor::BeamSensor(float forward, float left, float angle, float max_range)
+    : forward(forward), left(left), angle(angle), max_range(max_range) {}
+
+knights::MonteCarloLocalizer::MonteCarloLocalizer(const knights::FieldMap *map, std::vector<knights::BeamSensor> sensors, int particles,
+    knights::LocalizerNoise noise, std::uint32_t seed)
+    : map(map), sensors(sensors), noise(noise), random(seed) {
+    int count = (particles > 0) ? particles : 1;
+    this->x.assign(count, 0);
+    this->y.assign(count, 0);
+    this->heading.assign(count, 0);
+    this->weight.assign(count, 1.0 / count);
+}
+
+void knights::MonteCarloLocalizer::initialize(knights::Pos pose, float position_spread, float heading_spread) {
+    std::normal_distribution<float> position(0, position_spread > 0 ? position_spread : 0.0001);
+    std::normal_distribution<float> angle(0, heading_spread > 0 ? heading_spread : 0.0001);
+
+    int count = this->get_particle_count();
+    for (int i = 0; i < count; i++) {
+        this->x[i] = pose.x + position(this->random);
+        this->y[i] = pose.y + position(this->random);
+        this->heading[i] = pose.heading + angle(this->random);
+        this->weight[i] = 1.0 / count;
+    }
+}
+
+void knights::MonteCarloLocalizer::set_particle_count(int particles) {
+    if (particles > 0 && particles != this->get_particle_count())
+        this->resample(particles);
+}
+
+int knights::MonteCarloLocalizer::get_particle_count() const {
+    return this->x.size();
+}
+
+void knights::MonteCarloLocalizer::predict(knights::Pos previous, knights::Pos current) {
+    // change in pose relative to the robot at the previous pose
+    float delta_x = current.x - previous.x, delta_y = current.y - previous.y;
+    float forward = delta_x * cos(previous.heading) + delta_y * sin(previous.heading);
+    float lateral = -delta_x * sin(previous.heading) + delta_y * cos(previous.heading);
+    float turn = knights::min_angle(previous.heading, current.heading, true);
+
+    float distance = std::hypot(forward, lateral);
+    std::normal_distribution<float> forward_noise(0, this->noise.forward * distance + this->noise.minimum_position);
+    std::normal_distribution<float> lateral_noise(0, this->noise.lateral * distance + this->noise.minimum_position);
+    std::normal_distribution<float> turn_noise(0, this->noise.heading * fabsf(turn) + this->noise.heading_per_inch * distance + this->noise.minimum_heading);
+
+    int count = this->get_particle_count();
+    for (int i = 0; i < count; i++) {
+        float particle_forward = forward + forward_noise(this->random);
+        float particle_lateral = lateral + lateral_noise(this->random);
+        float particle_turn = turn + turn_noise(this->random);
+
+        // the same motion from each particle's own heading
+        float average_heading = this->heading[i] + particle_turn / 2;
+        this->x[i] += particle_forward * cos(average_heading) - particle_lateral * sin(average_heading);
+        this->y[i] += particle_forward * sin(average_heading) + particle_lateral * cos(average_heading);
+        this->heading[i] += particle_turn;
+    }
+}
+
+int knights::MonteCarloLocalizer::update(const float *distances) {
+    int count = this->get_particle_count();
+    this->cos_heading.resize(count);
+    this->sin_heading.resize(count);
+    this->ray_x.resize(count);
+    this->ray_y.resize(count);
+    this->ray_cos.resize(count);
+    this->ray_sin.resize(count);
+    this->expected.resize(count);
+    this->log_weight.assign(count, 0);
+
+    // plain pointers so the compiler knows the arrays don't change under the loops, and can vectorize them
+    const float *x = this->x.data(), *y = this->y.data(), *heading = this->heading.data();
+    float *cos_heading = this->cos_heading.data(), *sin_heading = this->sin_heading.data();
+    float *ray_x = this->ray_x.data(), *ray_y = this->ray_y.data(), *ray_cos = this->ray_cos.data(), *ray_sin = this->ray_sin.data();
+    float *expected = this->expected.data(), *log_weight = this->log_weight.data(), *weight = this->weight.data();
+
+    for (int i = 0; i < count; i++) {
+        cos_heading[i] = cos(heading[i]);
+        sin_heading[i] = sin(heading[i]);
+    }
+
+    int used = 0;
+    for (int s = 0; s < (int)this->sensors.size(); s++) {
+        const BeamSensor &sensor = this->sensors[s];
+        float reading = distances[s];
+        // nothing in range reads as far past the maximum
+        if (reading < 0 || reading > sensor.max_range || std::isnan(reading))
+            continue;
+        used++;
+
+        // where the sensor is and which way it faces for every particle
+        float sensor_cos = cos(sensor.angle), sensor_sin = sin(sensor.angle);
+        float forward = sensor.forward, left = sensor.left;
+        for (int i = 0; i < count; i++) {
+            ray_x[i] = x[i] + forward * cos_heading[i] - left * sin_heading[i];
+            ray_y[i] = y[i] + forward * sin_heading[i] + left * cos_heading[i];
+            ray_cos[i] = cos_heading[i] * sensor_cos - sin_heading[i] * sensor_sin;
+            ray_sin[i] = sin_heading[i] * sensor_cos + cos_heading[i] * sensor_sin;
+        }
+        this->map->ray_cast(ray_x, ray_y, ray_cos, ray_sin, count, sensor.max_range * 2, expected);
+
+        // a normal distribution around the expected distance, mixed with a chance of seeing something that isn't mapped
+        float spread = this->noise.sensor + this->noise.sensor_fraction * reading;
+        float scale = (1 - this->noise.outlier) / (spread * sqrt(2 * M_PI));
+        float outlier = this->noise.outlier / sensor.max_range;
+        for (int i = 0; i < count; i++) {
+            float error = (reading - expected[i]) / spread;
+            log_weight[i] += log(scale * exp(-0.5 * error * error) + outlier);
+        }
+    }
+    if (used == 0)
+        return 0;
+
+    // weigh relative to the best particle so the exponent doesn't underflow
+    float best = log_weight[0];
+    for (int i = 1; i < count; i++)
+        best = (log_weight[i] > best) ? log_weight[i] : best;
+
+    float total = 0;
+    for (int i = 0; i < count; i++) {
+        weight[i] *= exp(log_weight[i] - best);
+        total += weight[i];
+    }
+
+    if (!(total > 0) || std::isinf(total)) {
+        for (int i = 0; i < count; i++)
+            weight[i] = 1.0 / count;
+    } else {
+        for (int i = 0; i < count; i++)
+            weight[i] /= total;
+    }
+
+    // only resample once the weight is on few enough particles, resampling every time loses particles for nothing
+    if (this->get_effective_particles() < count / 2.0)
+        this->resample(count);
+
+    return used;
+}
+
+void knights::MonteCarloLocalizer::resample(int particles) {
+    int count = this->get_particle_count();
+    std::vector<float> new_x(particles), new_y(particles), new_heading(particles);
+
+    // low variance resampling, one random offset and evenly spaced picks along the summed weights
+    float step = 1.0 / particles;
+    float pick = std::uniform_real_distribution<float>(0, step)(this->random);
+    float cumulative = this->weight[0];
+    int source = 0;
+    for (int i = 0; i < particles; i++) {
+        while (pick > cumulative && source < count - 1)
+            cumulative += this->weight[++source];
+        new_x[i] = this->x[source];
+        new_y[i] = this->y[source];
+        new_heading[i] = this->heading[source];
+        pick += step;
+    }
+
+    this->x.swap(new_x);
+    this->y.swap(new_y);
+    this->heading.swap(new_heading);
+    this->weight.assign(particles, step);
+}
+
+knights::Pos knights::MonteCarloLocalizer::get_estimate() const {
+    float sum_x = 0, sum_y = 0, sum_cos = 0, sum_sin = 0;
+    for (int i = 0; i < this->get_particle_count(); i++) {
+        sum_x += this->weight[i] * this->x[i];
+        sum_y += this->weight[i] * this->y[i];
+        sum_cos += this->weight[i] * cos(this->heading[i]);
+        sum_sin += this->weight[i] * sin(this->heading[i]);
+    }
+    return Pos(sum_x, sum_y, knights::normalize_angle(atan2(sum_sin, sum_cos), true));
+}
+
+float knights::MonteCarloLocalizer::get_spread() const {
+    Pos estimate = this->get_estimate();
+    float variance = 0;
+    for (int i = 0; i < this->get_particle_count(); i++) {
+        float dx = this->x[i] - estimate.x, dy = this->y[i] - estimate.y;
+        variance += this->weight[i] * (dx * dx + dy * dy);
+    }
+    return sqrt(variance);
+}
+
+float knights::MonteCarloLocalizer::get_effective_particles() const {
+    float sum_squares = 0;
+    for (int i = 0; i < this->get_particle_count(); i++)
+        sum_squares += this->weight[i] * this->weight[i];
+    return (sum_squares > 0) ? 1 / sum_squares : 0;
+}
@@ -0,0 +1,82 @@
+#include "knights/autonomous/path.h"
+#include "knights/autonomous/controller.h"
+#include "knights/autonomous/pid.h"
+#include "knights/autonomous/ramsete.h"
+
+#include "knights/driver/input.h"
+#include "knights/logger/logger.h"
+#include "knights/robot/chassis.h"
+#include "knights/util/calculation.h"
+#include "knights/util/position.h"
+
+#include "api.h"
+
+void knights::AdvancedRoute::execute(knights::RobotChassis *chassis, knights::PIDController *lateral_pid, knights::PIDController *turn_pid, knights::input::AutonomousInputMap *input_map) {
+    
+    knights::RamseteConstants ramsete_constants(1, 0.5);
+
+    knights::RobotController lateralController(chassis, lateral_pid, &ramsete_constants, false);
+    knights::RobotController turnController(chassis, turn_pid, &ramsete_constants, false);
+
+    // markers on follow routes run their functions through the input map
+    lateralController.set_input_map(input_map);
+
+    for (int i = 0; i < this->actions.size(); i++) {
+        const RouteAction &curr_action = this->actions[i];
+
+        // only leave the robot moving if the next action starts right away
+        float exit_velocity = (curr_action.next_start == knights::start_condition::IMMEDIATE) ? curr_action.exit_velocity : 0.0;
+
+        if (curr_action.type == knights::action_type::LATERAL) {
+            lateralController.lateral_move(curr_action.specific, curr_action.end_tolerance, curr_action.timeout, exit_velocity);
+            knights::logger::red(knights::logger::string_format("lateral %lf", curr_action.specific));
+        }
+        else if (curr_action.type == knights::action_type::TURN) {
+            turnController.turn_to_angle(curr_action.specific, 0,curr_action.end_tolerance, curr_action.timeout, true);
+            knights::logger::green(knights::logger::string_format("turn %lf", curr_action.specific));
+        }
+        else if (curr_action.type == knights::action_type::FOLLOW && curr_action.route_index >= 0 
+            && curr_action.route_index < this->profiles.size() && !this->profiles[curr_action.route_index].empty()) {
+            // precompiled trajectory, track it at the planned speed - make sure it has at least the trajectory's length to finish
+            std::vector<knights::ProfileTimestamp> &profile = this->profiles[curr_action.route_index];
+            const std::vector<knights::RouteMarker> &markers = curr_action.route_index < this->routes.size() ? 
+                this->routes[curr_action.route_index].markers : std::vector<knights::RouteMarker>();
+            lateralController.follow_trajectory_ramsete(profile, curr_action.lookahead >= 0, 
+                std::fmax(curr_action.timeout, profile.back().time + 500), markers);
+            knights::logger::cyan(knights::logger::string_format("ramsete: %d , pos: %lf %lf %lf , error: %lf", curr_action.route_index, 
+                chassis->get_position().x, chassis->get_position().y, chassis->get_position().heading, 
+                knights::distance_btwn(chassis->get_position(), profile.back().position)));
+        }
+        else if (curr_action.type == knights::action_type::FOLLOW && curr_action.route_index >= 0 && curr_action.route_index < this->routes.size()) {
+            knights::Route &route = this->routes[curr_action.route_index];
+            lateralController.follow_route_pursuit(
+                route, 
+                curr_action.lookahead, 
+                lateral_pid->get_max_speed(), 
+                knights::signum(curr_action.lookahead),
+                curr_action.end_tolerance, 
+                curr_action.timeout,
+                false,
+                exit_velocity
+            );
+            knights::logger::cyan(knights::logger::string_format("follow: %d , pos: %lf %lf %lf , error: %lf", curr_action.route_index, 
+                chassis->get_position().x, chassis->get_position().y, chassis->get_position().heading, 
+                knights::distance_btwn(chassis->get_position(), route.positions.back())));
+            // for (knights::Pos pos : route.positions) {
+            //     // knights::logger::yellow(knights::logger::string_format("p: %lf %lf %lf", pos.x, pos.y, pos.heading));
+            // }
+        }
+        else if (curr_action.type == knights::action_type::COMMAND) {
+            input_map->execute_action(curr_action.function_name);
+            knights::logger::blue(knights::logger::string_format("command %s", curr_action.function_name.c_str()));
+        }
+
+        // wait until the next action is allowed to start
+        if (curr_action.next_start == knights::start_condition::AFTER_DELAY) {
+            pros::delay(curr_action.next_value);
+        }
+        else if (curr_action.next_start == knights::start_condition::SETTLED) {
+            lateralController.wait_until_settled(curr_action.next_value);
+        }
+    }
+}
\ No newline at end of file
@@ -3,48 +3,42 @@
 #include "knights/autonomous/path.h"
 
 #include "knights/robot/chassis.h"
+#include "knights/robot/drivetrain.h"
+#include "knights/robot/kinematics.h"
 
 #include "knights/util/calculation.h"
 #include "knights/util/position.h"
+#include "knights/util/timer.h"
 
 #include "knights/logger/logger.h"
 #include "pros/motors.h"
 
+#include <algorithm>
 #include <math.h>
 
 
-float knights::circle_intersection(knights::Pos nxt, knights::Pos prev, knights::Pos curr, float lookahead_distance) {
-    knights::Pos dir = nxt - prev;
-    knights::Pos fro = prev - curr;
-
-    // get coefficents then calculate discriminant
-    float a = dir * dir;
-    float b = 2 * (fro * dir);
-    float c = (fro * fro) - lookahead_distance * lookahead_distance;
-    float discrim = b * b - 4 * a * c;
+void knights::RobotController::follow_route_pursuit(knights::Route &route, float lookahead_distance, const float max_speed, bool forwards, 
+    float end_tolerance, float timeout, float use_pid, float exit_velocity, bool async, knights::ExitCondition exit_condition) {
+    // make sure route is valid
+    if (route.positions.size() < 2) return;
+
+    if (async) {
+        this->run_async([=, this, &route]() { 
+            this->follow_route_pursuit(route, lookahead_distance, max_speed, forwards, end_tolerance, timeout, use_pid, exit_velocity, false, exit_condition); 
+        });
+        return;
+    }
+    this->start_motion();
 
-    // if there are valid solutions
-    if (discrim > 0) {
-        // calculate solutions
-        discrim = sqrt(discrim);
-        float s1 = (-b + discrim) / (2 * a);
-        float s2 = (-b - discrim) / (2 * a);
+    // make sure the geometry cache is built, the positions might have been edited after the route was made
+    if (!route.geometry_valid())
+        route.compute_geometry();
 
-        if (s1 >= 0 && s1 <= 1) // if solution 1 is valid, return it
-            return s1;
-        else if (s2 >= 0 && s2 <= 1) // if solution 2 is valid, return it
-            return s2;
-        else
-            return -1;
-    } else // no or one real solution
-        return -1;
-}
-
-void knights::RobotController::follow_route_pursuit(knights::Route &route, float lookahead_distance, const float max_speed, bool forwards, 
-    float end_tolerance, float timeout, float use_pid) {
-    // make sure this is only movement running and route is valid
-    if (this->in_motion || route.positions.size() < 2) return;
-    this->in_motion = true;
+    // every point is in the same place, there's nothing to follow and the progress along it would divide by 0
+    if (route.arc_lengths.back() <= 0) {
+        this->end_motion();
+        return;
+    }
 
     // follow a pure pursuit route  
 
@@ -60,33 +54,122 @@ void knights::RobotController::follow_route_pursuit(knights::Route &route, float
         end_tolerance = fabs(end_tolerance);
     }
 
+    if (this->chassis->holonomic != nullptr) {
+        // holonomic drives translate straight at the lookahead point and turn to face along the route at the same time
+        knights::Holonomic *holonomic = this->chassis->holonomic;
+        holonomic->set_brake_mode(pros::E_MOTOR_BRAKE_BRAKE);
+
+        knights::PIDController angular_pid = (this->angular_pid_controller != nullptr) ? *this->angular_pid_controller : *this->pid_controller;
+        angular_pid.reset();
+        knights::Timer loop_timer;
+
+        knights::RouteProgress progress;
+        knights::RouteProgress lookahead_progress;
+        std::vector<bool> fired_markers(route.markers.size(), false);
+        float error = distance_btwn(this->chassis->get_position(), route.positions.back());
+        float exit_speed = std::fmin(fabs(exit_velocity) * 127.0 / holonomic->max_translation_velocity(), max_speed);
+        float direction_x = 0, direction_y = 0;
+
+        bool use_exit = exit_condition.enabled();
+        exit_condition.reset();
+        knights::Timer timer;
+
+        while (use_exit || (error > end_tolerance && progress.distance < route.arc_lengths.back())) {
+            if (timer.get() > timeout || this->cancel_requested) break;
+
+            knights::Pos curr_position = this->chassis->get_position();
+            error = distance_btwn(curr_position, route.positions.back());
+
+            knights::ChassisSpeeds measured = this->chassis->get_measured_velocity();
+            if (use_exit && exit_condition.update(error, std::hypot(measured.forward, measured.left), timer.get())) break;
+
+            progress = route.project(curr_position, progress);
+            this->update_progress(progress.distance, progress.distance / route.arc_lengths.back());
+            this->fire_markers(route.markers, fired_markers, progress.distance, route.arc_lengths.back());
+
+            knights::RouteProgress search_start = progress;
+            if (lookahead_progress.distance > progress.distance && distance_btwn(curr_position, lookahead_progress.point) <= lookahead_distance)
+                search_start = lookahead_progress;
+            lookahead_progress = route.lookahead(curr_position, lookahead_distance, search_start);
+            knights::Pos target_point = lookahead_progress.point;
+
+            // slow down on sharp parts of the route and once the lookahead point reaches its end
+            float target_speed = std::fmin(2/fabs(route.curvature_at(progress)), max_speed);
+            float target_distance = distance_btwn(curr_position, target_point);
+            if (target_distance / lookahead_distance < 0.3)
+                target_speed *= target_distance / lookahead_distance * 1.5;
+            target_speed = std::fmax(target_speed, exit_speed);
+
+            if (target_distance > 0) {
+                direction_x = (target_point.x - curr_position.x) / target_distance;
+                direction_y = (target_point.y - curr_position.y) / target_distance;
+            }
+
+            // face along the route's segment at the lookahead point, with the back if not forwards
+            int segment = std::min(lookahead_progress.segment, (int)route.segment_directions.size() - 1);
+            float desired_heading = atan2(route.segment_directions[segment].y, route.segment_directions[segment].x) + (forwards ? 0 : M_PI);
+            float heading_error = min_angle(curr_position.heading, desired_heading, true);
+
+            float dt = loop_timer.get();
+            loop_timer.reset();
+            float turn = angular_pid.calculate(0, -heading_error, dt, false);
+
+            knights::ChassisSpeeds speeds = knights::ChassisSpeeds::from_field(direction_x * target_speed, direction_y * target_speed, turn, curr_position.heading);
+            holonomic->move(speeds.forward, speeds.left, speeds.angular);
+
+            pros::delay(10);
+        }
+
+        // stop, or keep driving the way the route ended - always stop if cancelled
+        if (this->cancel_requested || exit_speed == 0)
+            holonomic->stop();
+        else {
+            knights::ChassisSpeeds speeds = knights::ChassisSpeeds::from_field(direction_x * exit_speed, direction_y * exit_speed, 0,
+                this->chassis->get_position().heading);
+            holonomic->move(speeds.forward, speeds.left, 0);
+        }
+
+        this->end_motion();
+        return;
+    }
+
     // make sure motors are on break - prevent drift at end
     this->chassis->drivetrain->right_mtrs->set_brake_mode(pros::E_MOTOR_BRAKE_BRAKE);
     this->chassis->drivetrain->left_mtrs->set_brake_mode(pros::E_MOTOR_BRAKE_BRAKE);
 
     // declare essential values
     knights::Pos target_point = route.positions[0];
-    int closest_i = 0;
-    float closest_dist = 1e5;
-    float error = distance_btwn(this->chassis->curr_position, route.positions[route.positions.size()-1]);
+    knights::RouteProgress progress; // where the robot is projected onto the route
+    knights::RouteProgress lookahead_progress; // where the lookahead point was found last loop
+    float error = distance_btwn(this->chassis->get_position(), route.positions[route.positions.size()-1]);
     float prev_error = error; float total_error = 0.0;
 
     float max_lookahead = lookahead_distance;
+    std::vector<bool> fired_markers(route.markers.size(), false);
+
+    // slowest speed to drive at when carrying velocity into the next movement
+    float exit_speed = std::fmin(fabs(exit_velocity) * 127.0 / this->chassis->drivetrain->max_velocity(), max_speed);
     float angular_curve;
 
+    // exit conditions replace the end tolerance and the end of route check when any are given
+    bool use_exit = exit_condition.enabled();
+    exit_condition.reset();
+    knights::Timer timer;
+    int loop_count = 0;
+
     // While the robot has not reached the desired point and is not at the end of the route
-    while (error > end_tolerance && closest_i != route.positions.size()-1 ) {
+    while (use_exit || (error > end_tolerance && progress.distance < route.arc_lengths.back())) {
 
-        knights::Pos curr_position = this->chassis->curr_position;
+        knights::Pos curr_position = this->chassis->get_position();
         if (!forwards || lookahead_distance < 0) {
             curr_position.heading = knights::normalize_angle(curr_position.heading + M_PI);
         }
 
         // lookahead scaling
-        if (target_point != route.positions[0]) { // make sure we have valid closest_i variables, it won't be right if the robot is at the start of the route
+        if (target_point != route.positions[0]) { // make sure we have a valid projection, it won't be right if the robot is at the start of the route
             lookahead_distance = clamp(
             max_lookahead * 
-            (4/curvature(route.positions[closest_i], route.positions[closest_i+1], route.positions[closest_i+2])) // tuned formula dependent on curvature
+            (4/fabs(route.curvature_at(progress))) // tuned formula dependent on curvature
             /max_speed,
             max_lookahead*0.8, max_lookahead*3); // limit lookahead from going too high or too low
         }
@@ -95,34 +178,33 @@ void knights::RobotController::follow_route_pursuit(knights::Route &route, float
         error = distance_btwn(curr_position, route.positions[route.positions.size()-1]);
         total_error += error;
 
-        closest_dist = 1e5;
+        float velocity = this->chassis->get_measured_velocity().forward;
+        if (use_exit && exit_condition.update(error, velocity, timer.get())) break;
 
-        // find nearest point
-        for (int i = closest_i; i < route.positions.size(); i++) {
-            if (distance_btwn(curr_position,  route.positions[i]) < closest_dist) {
-                closest_dist = distance_btwn(curr_position,  route.positions[i]);
-                closest_i = i;
-            }
-        }
+        // project the robot onto the route, only looking a few segments ahead of where it was last loop
+        progress = route.project(curr_position, progress);
+        this->update_progress(progress.distance, progress.distance / route.arc_lengths.back());
+        this->fire_markers(route.markers, fired_markers, progress.distance, route.arc_lengths.back());
 
-        // find lookahead point
-        for (int i = closest_i; i < route.positions.size() - 1; i++) {
-            float t = circle_intersection(route.positions[i+1], route.positions[i], curr_position, lookahead_distance);
+        // find lookahead point, resuming from last loop's unless the robot passed it or it is now outside the circle
+        knights::RouteProgress search_start = progress;
+        if (lookahead_progress.distance > progress.distance && distance_btwn(curr_position, lookahead_progress.point) <= lookahead_distance)
+            search_start = lookahead_progress;
 
-            if (t != -1) {
-                target_point = lerp(route.positions[i], route.positions[i+1], t);
-            }
-        }
+        lookahead_progress = route.lookahead(curr_position, lookahead_distance, search_start);
+        target_point = lookahead_progress.point;
 
         // determine the speed and angular curvature to use for calculating ratio of motor velocities
-        float target_speed = std::fmin(2/curvature(route.positions[closest_i], route.positions[closest_i+1], route.positions[closest_i+2]), max_speed);
+        float target_speed = std::fmin(2/fabs(route.curvature_at(progress)), max_speed);
         angular_curve = curvature(curr_position, target_point);
 
         // decrease angular curve if the target point is at the end of the path
-        if (distance_btwn(curr_position, target_point)/lookahead_distance < 0.3) {
-            angular_curve *= ((distance_btwn(curr_position, target_point)/lookahead_distance) * 0.1);
-            target_speed *= (distance_btwn(curr_position, target_point)/lookahead_distance) * 1.5;
+        float target_ratio = distance_btwn(curr_position, target_point)/lookahead_distance;
+        if (target_ratio < 0.3) {
+            angular_curve *= (target_ratio * 0.1);
+            target_speed *= target_ratio * 1.5;
         }
+        target_speed = std::fmax(target_speed, exit_speed);
 
         // // determine speed based on PID if selected to use
         // if (use_pid) {
@@ -147,26 +229,30 @@ void knights::RobotController::follow_route_pursuit(knights::Route &route, float
         else
             this->chassis->drivetrain->velocity_command(-l_speed, -r_speed);
 
-        // log for debugging
-        if (std::fmod(timeout, 75) == 0) {
-            logger::green(logger::string_format("target: %lf %lf , curr: %lf %lf %lf , target speed: %lf , used angular: %lf , side speed: %lf %lf , error: %lf  fwd: %d\n closest_i: %lf %lf %d , end pt: %lf %lf %d, real angular_curve: %lf, timeout: %lf, curr lhd: %lf, calculated lhd: %lf", 
-                target_point.x, target_point.y, this->chassis->curr_position.x, this->chassis->curr_position.y, this->chassis->curr_position.heading,
-                target_speed, angular_curve, r_speed, l_speed, error, forwards, route.positions[closest_i].x, route.positions[closest_i].y, closest_i, 
-                route.positions.back().x, route.positions.back().y, route.positions.size(), angular_curve/((distance_btwn(curr_position, target_point)/lookahead_distance) * 0.1), timeout, lookahead_distance, distance_btwn(this->chassis->curr_position, target_point)/lookahead_distance
+        // log for debugging, every 15 loops
+        if (loop_count++ % 15 == 0) {
+            logger::green(logger::string_format("target: %lf %lf , curr: %lf %lf %lf , target speed: %lf , used angular: %lf , side speed: %lf %lf , error: %lf  fwd: %d\n progress: %lf %lf %d %lf , end pt: %lf %lf %d, real angular_curve: %lf, time: %lf, curr lhd: %lf, calculated lhd: %lf", 
+                target_point.x, target_point.y, this->chassis->get_position().x, this->chassis->get_position().y, this->chassis->get_position().heading,
+                target_speed, angular_curve, r_speed, l_speed, error, forwards, progress.point.x, progress.point.y, progress.segment, progress.distance, 
+                route.positions.back().x, route.positions.back().y, route.positions.size(), angular_curve/(target_ratio * 0.1), (double)timer.get(), lookahead_distance, target_ratio
             ));
         }
 
         // wait for next iteration of loop
         pros::delay(10);
-        timeout -= 10;
 
-        if (timeout < 0) break;
+        if (timer.get() > timeout || this->cancel_requested) break;
     }
 
-    // stop motors after route over
-    this->chassis->drivetrain->velocity_command(0, 0);
+    // stop motors after route over, or keep driving into the next movement - always stop if cancelled
+    if (this->cancel_requested || exit_speed == 0)
+        this->chassis->drivetrain->stop();
+    else if (forwards)
+        this->chassis->drivetrain->velocity_command(exit_speed, exit_speed);
+    else
+        this->chassis->drivetrain->velocity_command(-exit_speed, -exit_speed);
 
-    this->in_motion = false;
+    this->end_motion();
     return;
     
 }
@@ -7,32 +7,63 @@
 #include "knights/util/calculation.h"
 
 #include "knights/util/position.h"
-
-void knights::RobotController::move_to_point(const Pos desired_position, const bool forwards, const float &end_tolerance, float timeout) {
+#include "knights/util/timer.h"
+
+void knights::RobotController::move_to_point(const Pos desired_position, const bool forwards, const float &end_tolerance, float timeout, bool async,
+    knights::ExitCondition exit_condition) {
+    if (async) {
+        float tolerance = end_tolerance;
+        this->run_async([=, this]() { this->move_to_point(desired_position, forwards, tolerance, timeout, false, exit_condition); });
+        return;
+    }
+    this->start_motion();
     
     // lateral move the chassis of a robot
     if (this->chassis->drivetrain != nullptr) {
         // move function for differential drive
         float speed,error;
-        float prev_error = distance_btwn(desired_position, this->chassis->curr_position); float total_error = 0.0;
+        float start_distance = distance_btwn(desired_position, this->chassis->get_position());
+        Pos start_position = this->chassis->get_position();
+
+        // clear the integral and derivative left from the last movement
+        this->pid_controller->reset();
+        knights::Timer loop_timer;
+
+        // exit conditions replace the end tolerance and the minimum speed check when any are given
+        bool use_exit = exit_condition.enabled();
+        exit_condition.reset();
+        knights::Timer timer;
         
-        while (knights::distance_btwn(this->chassis->curr_position, desired_position) > end_tolerance || 
-            knights::distance_btwn(this->chassis->prev_position, desired_position) < knights::distance_btwn(this->chassis->curr_position, desired_position)) {
-            // decrease timeout and break if went over
-            timeout -= 10;
-            if (timeout < 0) break;
+        while (use_exit || this->not_arrived(desired_position, end_tolerance)) {
+            // break if went over the timeout
+            if (timer.get() > timeout || this->cancel_requested) break;
+
+            // one snapshot per loop, so every calculation uses the same odometry update
+            Pos curr_position = this->chassis->get_position();
 
             // calculate error
-            error = knights::distance_btwn(this->chassis->curr_position, desired_position);
+            error = knights::distance_btwn(curr_position, desired_position);
 
-            // integrate error
-            total_error += error;
+            if (use_exit) {
+                // the point is behind the robot once it drives past it, so the error goes negative and the robot backs up
+                float heading = curr_position.heading + (forwards ? 0 : M_PI);
+                if ((desired_position.x - curr_position.x) * cos(heading) + (desired_position.y - curr_position.y) * sin(heading) < 0)
+                    error = -error;
 
-            // use pid formula to calculate speed
-            speed = this->pid_controller->update(error, total_error, prev_error);
+                float velocity = this->chassis->get_measured_velocity().forward;
+                if (exit_condition.update(error, velocity, timer.get())) break;
+            }
+
+            if (start_distance > 0)
+                this->update_progress(knights::distance_btwn(start_position, curr_position), 1 - error / start_distance);
+
+            // use pid formula to calculate speed, the measurement is how much closer the robot has gotten
+            float dt = loop_timer.get();
+            loop_timer.reset();
+            speed = this->pid_controller->calculate(start_distance, start_distance - error, dt);
 
             // end if speed below minimum
-            if (fabs(speed) <= this->pid_controller->min_velocity) {
+            if (!use_exit && fabs(speed) <= this->pid_controller->min_velocity) {
                 break;
             }
 
@@ -40,13 +71,10 @@ void knights::RobotController::move_to_point(const Pos desired_position, const b
             if (!forwards)
                 speed *= -1;
 
-            // save previous error
-            prev_error = error;
-
             // calculate angular curve to point we want to go at
-            float angular_curve = curvature(this->chassis->curr_position, desired_position);
+            float angular_curve = curvature(curr_position, desired_position);
             if (!forwards) {
-                angular_curve = curvature(Pos(this->chassis->curr_position.x, this->chassis->curr_position.y, this->chassis->curr_position.heading-M_PI), desired_position);
+                angular_curve = curvature(Pos(curr_position.x, curr_position.y, curr_position.heading-M_PI), desired_position);
             }
             
             // calculate right and left speed based on curvature
@@ -68,10 +96,14 @@ void knights::RobotController::move_to_point(const Pos desired_position, const b
         }
 
         // stop drivetrain 
-        this->chassis->drivetrain->right_mtrs->move(0);
-        this->chassis->drivetrain->left_mtrs->move(0);
+        this->chassis->drivetrain->stop();
 
+    } else if (this->chassis->holonomic != nullptr) {
+        // holonomic drives strafe straight to the point, holding their heading
+        Pos desired_pose(desired_position.x, desired_position.y, this->chassis->get_position().heading);
+        this->holonomic_move(desired_pose, 0, end_tolerance, HOLONOMIC_HEADING_TOLERANCE, timeout, 0, exit_condition);
     }
 
+    this->end_motion();
     return;
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "knights/autonomous/controller.h"
+#include "knights/autonomous/pid.h"
+
+#include "knights/robot/chassis.h"
+#include "knights/robot/drivetrain.h"
+
+#include "knights/util/calculation.h"
+#include "knights/util/position.h"
+#include "knights/util/timer.h"
+
+#include "pros/motors.h"
+#include "pros/rtos.hpp"
+
+// distance from the target to stop steering to the carrot at, it is on top of the target so steering to it would spin the robot
+#define BOOMERANG_SETTLE_DISTANCE 6.0
+
+void knights::RobotController::move_to_pose(const Pos desired_pose, const bool forwards, float lead, float end_tolerance, float timeout,
+    float exit_velocity, bool async, knights::ExitCondition exit_condition) {
+    if (async) {
+        this->run_async([=, this]() { this->move_to_pose(desired_pose, forwards, lead, end_tolerance, timeout, exit_velocity, false, exit_condition); });
+        return;
+    }
+    this->start_motion();
+
+    if (this->chassis->holonomic != nullptr) {
+        // holonomic drives go straight to the position and turn to the heading on the way, no carrot needed
+        this->holonomic_move(desired_pose, min_angle(this->chassis->get_position().heading, desired_pose.heading, true), end_tolerance,
+            HOLONOMIC_HEADING_TOLERANCE, timeout, exit_velocity, exit_condition);
+        this->end_motion();
+        return;
+    }
+
+    if (this->chassis->drivetrain == nullptr) {
+        this->end_motion();
+        return;
+    }
+
+    knights::Drivetrain *drivetrain = this->chassis->drivetrain;
+
+    drivetrain->right_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+    drivetrain->left_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+
+    // direction the robot drives in when it reaches the pose, its heading or the opposite when driving backwards
+    float travel_heading = desired_pose.heading + (forwards ? 0 : M_PI);
+    float travel_x = cos(travel_heading), travel_y = sin(travel_heading);
+
+    // slowest speed to drive at when carrying velocity into the next movement
+    float exit_speed = fabsf(exit_velocity) * 127.0 / drivetrain->max_velocity();
+
+    float start_distance = distance_btwn(desired_pose, this->chassis->get_position());
+    Pos start_position = this->chassis->get_position();
+
+    // clear the integral and derivative left from the last movement
+    this->pid_controller->reset();
+    knights::Timer loop_timer;
+
+    // exit conditions replace the end tolerance and the minimum speed check when any are given
+    bool use_exit = exit_condition.enabled();
+    exit_condition.reset();
+    knights::Timer timer;
+
+    while (!this->cancel_requested) {
+        if (timer.get() > timeout) break;
+
+        Pos curr_position = this->chassis->get_position();
+        float error = distance_btwn(curr_position, desired_pose);
+
+        // close to the target and past the line through it, across the direction the robot should be driving
+        bool passed = error <= BOOMERANG_SETTLE_DISTANCE &&
+            (curr_position.x - desired_pose.x) * travel_x + (curr_position.y - desired_pose.y) * travel_y > 0;
+
+        if (start_distance > 0)
+            this->update_progress(distance_btwn(start_position, curr_position), 1 - error / start_distance);
+
+        // once close, only drive along the robot's heading - the distance to the target along it, negative if the robot went past.
+        // blended in over the settle distance before that, so the PID's measurement doesn't jump and kick the derivative
+        float drive_heading = curr_position.heading + (forwards ? 0 : M_PI);
+        float along = (desired_pose.x - curr_position.x) * cos(drive_heading) + (desired_pose.y - curr_position.y) * sin(drive_heading);
+        float straight = knights::clamp(error / BOOMERANG_SETTLE_DISTANCE - 1, 0.0f, 1.0f);
+        float linear_error = straight * error + (1 - straight) * along;
+
+        if (use_exit) {
+            float velocity = this->chassis->get_measured_velocity().forward;
+            if (exit_condition.update(linear_error, velocity, timer.get())) break;
+        } else if (error <= end_tolerance || (exit_speed > 0 && passed))
+            break;
+
+        // carrot point behind the target along its heading, pulled in as the robot gets closer so it arrives facing the heading
+        Pos carrot(desired_pose.x - travel_x * lead * error, desired_pose.y - travel_y * lead * error, desired_pose.heading);
+
+        // use pid formula to calculate speed, the measurement is how much closer the robot has gotten
+        float dt = loop_timer.get();
+        loop_timer.reset();
+        float speed = this->pid_controller->calculate(start_distance, start_distance - linear_error, dt);
+
+        if (!use_exit && exit_speed == 0 && fabs(speed) <= this->pid_controller->min_velocity && error <= BOOMERANG_SETTLE_DISTANCE)
+            break;
+        if (exit_speed > 0)
+            speed = std::fmax(speed, exit_speed);
+
+        // steer towards the carrot, or once it is on top of the target, towards a point past the target along its heading to line up with it
+        if (error <= BOOMERANG_SETTLE_DISTANCE)
+            carrot = Pos(desired_pose.x + travel_x * BOOMERANG_SETTLE_DISTANCE, desired_pose.y + travel_y * BOOMERANG_SETTLE_DISTANCE, desired_pose.heading);
+
+        Pos steer_position = curr_position;
+        if (!forwards)
+            steer_position.heading -= M_PI;
+        float angular_curve = curvature(steer_position, carrot);
+
+        // reverse speed to move backward
+        if (!forwards)
+            speed *= -1;
+
+        // calculate right and left speed based on curvature
+        float r_speed = speed * (2 - angular_curve * drivetrain->track_width) / 2;
+        float l_speed = speed * (2 + angular_curve * drivetrain->track_width) / 2;
+
+        // keep both sides under the max speed without changing the ratio between them
+        float max_curr_speed = std::fmax(fabs(r_speed), fabs(l_speed)) / this->pid_controller->max_velocity;
+        if (max_curr_speed > 1) {
+            r_speed /= max_curr_speed;
+            l_speed /= max_curr_speed;
+        }
+
+        drivetrain->velocity_command(r_speed, l_speed);
+
+        pros::delay(10);
+    }
+
+    // stop, or keep driving into the next movement - always stop if cancelled
+    if (this->cancel_requested || exit_speed == 0)
+        drivetrain->stop();
+    else {
+        float end_speed = forwards ? exit_speed : -exit_speed;
+        drivetrain->velocity_command(end_speed, end_speed);
+    }
+
+    this->end_motion();
+    return;
+}
@@ -0,0 +1,122 @@
+#include "knights/autonomous/controller.h"
+#include "knights/autonomous/pid.h"
+#include "knights/autonomous/profile.h"
+
+#include "knights/robot/chassis.h"
+#include "knights/robot/drivetrain.h"
+
+#include "knights/util/calculation.h"
+#include "knights/util/timer.h"
+
+#include "knights/logger/logger.h"
+#include "pros/motors.h"
+#include "pros/rtos.hpp"
+
+void knights::RobotController::profiled_turn_to_angle(const float angle, int direction, float max_velocity, float max_acceleration, float max_jerk,
+    float end_tolerance, float timeout, bool rad, bool async, knights::ExitCondition exit_condition) {
+    if (async) {
+        this->run_async([=, this]() {
+            this->profiled_turn_to_angle(angle, direction, max_velocity, max_acceleration, max_jerk, end_tolerance, timeout, rad, false, exit_condition);
+        });
+        return;
+    }
+    this->start_motion();
+
+    knights::Drivetrain *drivetrain = this->chassis->drivetrain;
+    float desired_angle;
+
+    if (rad) // inputs provided in rads
+        desired_angle = normalize_angle(angle, true);
+    else { // inputs provided in degrees
+        desired_angle = normalize_angle(to_rad(angle), true);
+        end_tolerance = to_rad(end_tolerance);
+        max_velocity = to_rad(max_velocity);
+        max_acceleration = to_rad(max_acceleration);
+        max_jerk = to_rad(max_jerk);
+    }
+
+    // get direction to turn (l, r, best), then which way that is on the unit circle
+    int sign = knights::signum(direction);
+    if (sign == 0)
+        sign = knights::direction(this->chassis->get_position().heading, desired_angle);
+    float counterclockwise = -sign;
+
+    // angle left to turn in the turning direction, the long way around if the direction was forced
+    float remaining = counterclockwise * min_angle(this->chassis->get_position().heading, desired_angle, true);
+    if (remaining < 0)
+        remaining += M_PI * 2;
+    float total_angle = remaining;
+
+    if (this->chassis->holonomic != nullptr) {
+        // holonomic drives turn in place with odometry like turn_to_angle, holding their position - without a profile
+        Pos desired_position = this->chassis->get_position();
+        desired_position.heading = desired_angle;
+
+        this->holonomic_move(desired_position, counterclockwise * total_angle, HOLONOMIC_POSITION_TOLERANCE, end_tolerance, timeout, 0, exit_condition);
+        this->end_motion();
+        return;
+    }
+    if (drivetrain == nullptr) {
+        this->end_motion();
+        return;
+    }
+
+    // plan from the angular velocity the robot already has, radians per second in the turning direction
+    float half_track = drivetrain->track_width / 2;
+    float start_velocity = std::fmax(counterclockwise * this->chassis->get_measured_velocity().angular, 0.0f);
+    knights::MotionProfile profile(total_angle, max_velocity, max_acceleration, max_jerk, start_velocity);
+
+    knights::logger::yellow(knights::logger::string_format("profiled turn: %lf rad, %lf s", total_angle, profile.duration()));
+
+    drivetrain->right_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+    drivetrain->left_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+
+    // the PID only corrects what the feedforward misses, its output is scaled from motor units to radians per second
+    float pid_scale = drivetrain->max_velocity() / 127.0 / half_track;
+    this->pid_controller->reset();
+    knights::Timer loop_timer;
+
+    // exit conditions replace the end tolerance when any are given
+    bool use_exit = exit_condition.enabled();
+    exit_condition.reset();
+    knights::Timer timer;
+
+    while (!this->cancel_requested) {
+        float elapsed = timer.get();
+        if (elapsed > timeout) break;
+
+        // kept continuous with last loop so it goes negative if the robot turns past the target
+        remaining = knights::unwrap_angle(counterclockwise * min_angle(this->chassis->get_position().heading, desired_angle, true), remaining);
+        float turned = total_angle - remaining;
+
+        if (total_angle > 0)
+            this->update_progress(to_deg(std::fmax(turned, 0.0f)), turned / total_angle);
+
+        float angular_velocity = this->chassis->get_measured_velocity().angular;
+        bool profile_done = elapsed / 1000 >= profile.duration();
+
+        if (use_exit) {
+            if (exit_condition.update(to_deg(remaining), to_deg(angular_velocity), elapsed)) break;
+        } else if (profile_done && fabsf(remaining) <= end_tolerance)
+            break;
+
+        // follow the profile with feedforward, and correct the angle error with PID
+        knights::ProfileState desired = profile.at(elapsed / 1000);
+
+        float dt = loop_timer.get();
+        loop_timer.reset();
+        float correction = this->pid_controller->calculate(desired.position, turned, dt, false) * pid_scale;
+
+        // wheel speeds for the angular velocity, the right side goes forward to turn counterclockwise
+        float side_velocity = counterclockwise * (desired.velocity + correction) * half_track;
+        float side_acceleration = counterclockwise * desired.acceleration * half_track;
+        drivetrain->feedforward_command(side_velocity, -side_velocity, side_acceleration, -side_acceleration);
+
+        pros::delay(10);
+    }
+
+    drivetrain->stop();
+
+    this->end_motion();
+    return;
+}
@@ -0,0 +1,140 @@
+#include "knights/autonomous/controller.h"
+#include "knights/autonomous/profile.h"
+#include "knights/autonomous/ramsete.h"
+
+#include "knights/robot/chassis.h"
+
+#include "knights/util/calculation.h"
+#include "knights/util/position.h"
+#include "knights/util/timer.h"
+
+#include "knights/logger/logger.h"
+#include "pros/motors.h"
+
+#include <math.h>
+
+void knights::RobotController::follow_trajectory_ramsete(const std::vector<ProfileTimestamp> &trajectory, bool forwards, float timeout, 
+    const std::vector<RouteMarker> &markers, bool async, knights::ExitCondition exit_condition) {
+    // make sure trajectory is valid
+    if (trajectory.empty() || this->chassis->drivetrain == nullptr) return;
+
+    if (async) {
+        this->run_async([=, this, &trajectory]() { this->follow_trajectory_ramsete(trajectory, forwards, timeout, markers, false, exit_condition); });
+        return;
+    }
+    this->start_motion();
+
+    // b must be greater than 0, zeta must be within (0,1) - defaults are the commonly used values
+    float b = 2.0, zeta = 0.7;
+    if (this->ramsete_constants != nullptr) {
+        b = this->ramsete_constants->damping;
+        zeta = this->ramsete_constants->proportional;
+    }
+
+    // make sure motors are on break - prevent drift at end
+    this->chassis->drivetrain->right_mtrs->set_brake_mode(pros::E_MOTOR_BRAKE_BRAKE);
+    this->chassis->drivetrain->left_mtrs->set_brake_mode(pros::E_MOTOR_BRAKE_BRAKE);
+
+    float track_width = this->chassis->drivetrain->track_width;
+    int i = 0;
+    std::vector<bool> fired_markers(markers.size(), false);
+
+    // exit conditions hold the robot on the last timestamp after the trajectory ends until they are met, when any are given
+    bool use_exit = exit_condition.enabled();
+    exit_condition.reset();
+
+    knights::Timer timer;
+
+    while (timer.get() < timeout && !this->cancel_requested) {
+        float elapsed = timer.get();
+
+        // move to the timestamp for the current time, the trajectory is sampled in order
+        while (i < trajectory.size() - 1 && trajectory[i+1].time <= elapsed)
+            i++;
+
+        if (i == trajectory.size() - 1 && elapsed > trajectory.back().time) {
+            if (!use_exit)
+                break;
+
+            float error = knights::distance_btwn(this->chassis->get_position(), trajectory.back().position);
+            float velocity = this->chassis->get_measured_velocity().forward;
+            if (exit_condition.update(error, velocity, elapsed))
+                break;
+        }
+
+        const knights::ProfileTimestamp &desired = trajectory[i];
+        if (trajectory.back().distance > 0)
+            this->update_progress(desired.distance, desired.distance / trajectory.back().distance);
+        this->fire_markers(markers, fired_markers, desired.distance, trajectory.back().distance);
+
+        knights::Pos curr_position = this->chassis->get_position();
+        if (!forwards)
+            curr_position.heading = knights::normalize_angle(curr_position.heading + M_PI);
+
+        // error in the robot's frame, in meters so the constants match the usual ones for RAMSETE
+        float dx = knights::to_meters(desired.position.x - curr_position.x);
+        float dy = knights::to_meters(desired.position.y - curr_position.y);
+        float error_x = cosf(curr_position.heading) * dx + sinf(curr_position.heading) * dy;
+        float error_y = -sinf(curr_position.heading) * dx + cosf(curr_position.heading) * dy;
+        float error_heading = knights::min_angle(curr_position.heading, desired.position.heading);
+
+        float desired_velocity = knights::to_meters(desired.expected_velocity);
+        float desired_omega = desired.angular_velocity;
+
+        // RAMSETE nonlinear feedback law
+        float gain = 2 * zeta * sqrtf(desired_omega * desired_omega + b * desired_velocity * desired_velocity);
+        float sinc = (fabsf(error_heading) < 1e-6) ? 1.0 : sinf(error_heading) / error_heading;
+
+        float velocity = desired_velocity * cosf(error_heading) + gain * error_x;
+        float omega = desired_omega + gain * error_heading + b * desired_velocity * sinc * error_y;
+
+        velocity = knights::to_inches(velocity);
+
+        // driving backwards flips the direction of the linear velocity, not the angular velocity
+        if (!forwards)
+            velocity = -velocity;
+
+        float r_speed = velocity + omega * track_width / 2;
+        float l_speed = velocity - omega * track_width / 2;
+
+        // planned acceleration of each side, for the feedforward model - backwards the sides swap and flip like the velocities
+        float r_accel = 0.0, l_accel = 0.0;
+        if (i < trajectory.size() - 1 && trajectory[i+1].time > desired.time) {
+            float seconds = (trajectory[i+1].time - desired.time) / 1000;
+            r_accel = (trajectory[i+1].right_speed - desired.right_speed) / seconds;
+            l_accel = (trajectory[i+1].left_speed - desired.left_speed) / seconds;
+        }
+        if (!forwards) {
+            float temp = r_accel;
+            r_accel = -l_accel;
+            l_accel = -temp;
+        }
+
+        this->chassis->drivetrain->feedforward_command(r_speed, l_speed, r_accel, l_accel);
+
+        // log for debugging
+        if (i % 10 == 0) {
+            logger::green(logger::string_format("ramsete t: %lf , desired: %lf %lf %lf , curr: %lf %lf %lf , v: %lf , w: %lf",
+                desired.time, desired.position.x, desired.position.y, desired.position.heading,
+                this->chassis->get_position().x, this->chassis->get_position().y, this->chassis->get_position().heading,
+                velocity, omega));
+        }
+
+        // wait for next iteration of loop
+        pros::delay(10);
+    }
+
+    // stop motors after trajectory over, or keep driving into the next movement if it ends moving
+    const knights::ProfileTimestamp &last = trajectory.back();
+    if (this->cancel_requested)
+        this->chassis->drivetrain->stop();
+    else if (last.expected_velocity > 0 && forwards)
+        this->chassis->drivetrain->feedforward_command(last.right_speed, last.left_speed);
+    else if (last.expected_velocity > 0)
+        this->chassis->drivetrain->feedforward_command(-last.left_speed, -last.right_speed);
+    else
+        this->chassis->drivetrain->stop();
+
+    this->end_motion();
+    return;
+}
@@ -2,22 +2,27 @@
 #include "knights/autonomous/pid.h"
 
 #include "knights/robot/chassis.h"
+#include "knights/robot/drivetrain.h"
 
 #include "knights/util/calculation.h"
+#include "knights/util/timer.h"
 
 #include "knights/logger/logger.h"
 
 #define MIN_SPEED 20
 
-void knights::RobotController::turn_to_angle(const float angle, int direction, float end_tolerance, float timeout, bool rad) {
-    if (this->in_motion) return;
-    this->in_motion = true;
+void knights::RobotController::turn_to_angle(const float angle, int direction, float end_tolerance, float timeout, bool rad, bool async,
+    knights::ExitCondition exit_condition) {
+    if (async) {
+        this->run_async([=, this]() { this->turn_to_angle(angle, direction, end_tolerance, timeout, rad, false, exit_condition); });
+        return;
+    }
+    this->start_motion();
 
     // get direction to turn (l, r, best)
     int sign = knights::signum(direction);
 
     float speed,error;
-    float prev_error = fabsf(to_rad(angle)); float total_error = 0.0;
     float desired_angle;
 
     if (rad == true) // inputs provided in rads
@@ -28,44 +33,72 @@ void knights::RobotController::turn_to_angle(const float angle, int direction, f
     }
 
     if (sign == 0) // if we're taking best direction
-        sign = knights::direction(this->chassis->curr_position.heading, desired_angle); // calculate direction
+        sign = knights::direction(this->chassis->get_position().heading, desired_angle); // calculate direction
+
+    // angle left to turn in the turning direction, the long way around if the direction was forced
+    error = -sign * min_angle(this->chassis->get_position().heading, desired_angle, true);
+    if (error < 0)
+        error += M_PI * 2;
+    float total_angle = error;
+
+    if (this->chassis->holonomic != nullptr) {
+        // holonomic drives turn in place with odometry, holding their position
+        Pos desired_position = this->chassis->get_position();
+        desired_position.heading = desired_angle;
+
+        this->holonomic_move(desired_position, -sign * total_angle, HOLONOMIC_POSITION_TOLERANCE, end_tolerance, timeout, 0, exit_condition);
+        this->end_motion();
+        return;
+    }
     
     if (sign == 1)
         knights::logger::yellow("clockwise");
     else
         knights::logger::yellow("counterclockwise");
     
+    // clear the integral and derivative left from the last movement
+    this->pid_controller->reset();
+    knights::Timer loop_timer;
+
+    // exit conditions replace the end tolerance and the minimum speed check when any are given
+    bool use_exit = exit_condition.enabled();
+    exit_condition.reset();
+    knights::Timer timer;
+
     // set brake mode to stop so we don't overshoot
     this->chassis->drivetrain->right_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
     this->chassis->drivetrain->left_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
 
-    while(std::abs(min_angle(this->chassis->curr_position.heading, desired_angle, true)) > end_tolerance) {
+    while(use_exit || std::abs(min_angle(this->chassis->get_position().heading, desired_angle, true)) > end_tolerance) {
 
-        timeout -= 10;
-        if (timeout < 0) break;
+        if (timer.get() > timeout || this->cancel_requested) break;
 
-        // calculate w/ PID formula
-        error = std::abs(min_angle(this->chassis->curr_position.heading, desired_angle, true));
+        // angle left to turn, kept continuous with last loop so it goes negative if the robot turns past the target
+        error = knights::unwrap_angle(-sign * min_angle(this->chassis->get_position().heading, desired_angle, true), error);
 
-        total_error += error;
+        float angular_velocity = this->chassis->get_measured_velocity().angular;
+        if (use_exit && exit_condition.update(to_deg(error), to_deg(angular_velocity), timer.get())) break;
 
-        speed = this->pid_controller->update(error, total_error, prev_error);
+        if (total_angle > 0)
+            this->update_progress(to_deg(std::fmax(total_angle - error, 0.0f)), 1 - error / total_angle);
 
-        prev_error = error;
+        float dt = loop_timer.get();
+        loop_timer.reset();
+        speed = this->pid_controller->calculate(total_angle, total_angle - error, dt);
 
-        knights::logger::green(knights::logger::string_format("des angle: %lf, curr angle %lf, error %lf, speed: %lf\n", desired_angle, this->chassis->curr_position.heading, error, speed));
+        knights::logger::green(knights::logger::string_format("des angle: %lf, curr angle %lf, error %lf, speed: %lf\n", desired_angle, this->chassis->get_position().heading, error, speed));
 
         this->chassis->drivetrain->velocity_command(-sign * speed, sign * speed);
 
-        if (speed < MIN_SPEED) {
+        if (!use_exit && fabs(speed) < MIN_SPEED) {
             break;
         }
 
         pros::delay(10);
     }
 
-    this->chassis->drivetrain->velocity_command(0, 0);
+    this->chassis->drivetrain->stop();
 
-    this->in_motion = false;
+    this->end_motion();
     return;
 }
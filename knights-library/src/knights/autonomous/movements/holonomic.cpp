@@ -0,0 +1,99 @@
+#include "knights/autonomous/controller.h"
+#include "knights/autonomous/pid.h"
+
+#include "knights/robot/chassis.h"
+#include "knights/robot/drivetrain.h"
+#include "knights/robot/kinematics.h"
+
+#include "knights/util/calculation.h"
+#include "knights/util/position.h"
+#include "knights/util/timer.h"
+
+#include "pros/motors.h"
+#include "pros/rtos.hpp"
+
+void knights::RobotController::holonomic_move(const Pos target, float heading_error, float end_tolerance, float angle_tolerance, float timeout,
+    float exit_velocity, knights::ExitCondition exit_condition) {
+    knights::Holonomic *holonomic = this->chassis->holonomic;
+    holonomic->set_brake_mode(pros::E_MOTOR_BRAKE_BRAKE);
+
+    // turning gets its own controller so its integral and derivative don't mix with the translation's
+    knights::PIDController angular_pid = (this->angular_pid_controller != nullptr) ? *this->angular_pid_controller : *this->pid_controller;
+    angular_pid.reset();
+    this->pid_controller->reset();
+
+    // slowest speed to drive at when carrying velocity into the next movement
+    float exit_speed = fabsf(exit_velocity) * 127.0 / holonomic->max_translation_velocity();
+
+    Pos start_position = this->chassis->get_position();
+    float start_distance = distance_btwn(start_position, target);
+    float total_angle = heading_error;
+
+    // movements that don't go anywhere are turns, their progress and exit conditions are on the angle
+    bool turning = start_distance <= end_tolerance;
+
+    // direction to the target on the field, kept once the robot is on it so it can carry on driving the same way
+    float direction_x = 0, direction_y = 0;
+    if (start_distance > 0) {
+        direction_x = (target.x - start_position.x) / start_distance;
+        direction_y = (target.y - start_position.y) / start_distance;
+    }
+
+    bool use_exit = exit_condition.enabled();
+    exit_condition.reset();
+    knights::Timer loop_timer;
+    knights::Timer timer;
+
+    while (!this->cancel_requested) {
+        if (timer.get() > timeout) break;
+
+        Pos curr_position = this->chassis->get_position();
+        float error = distance_btwn(curr_position, target);
+
+        // angle left to turn, kept continuous with last loop so a forced long turn stays long and overshooting goes negative
+        heading_error = knights::unwrap_angle(min_angle(curr_position.heading, target.heading, true), heading_error);
+
+        if (turning) {
+            if (total_angle != 0)
+                this->update_progress(to_deg(fabsf(total_angle - heading_error)), 1 - heading_error / total_angle);
+        } else
+            this->update_progress(distance_btwn(start_position, curr_position), 1 - error / start_distance);
+
+        if (use_exit) {
+            knights::ChassisSpeeds measured = this->chassis->get_measured_velocity();
+            if (turning) {
+                if (exit_condition.update(to_deg(heading_error), to_deg(measured.angular), timer.get())) break;
+            } else if (exit_condition.update(error, std::hypot(measured.forward, measured.left), timer.get()))
+                break;
+        } else if (error <= end_tolerance && (exit_speed > 0 || fabsf(heading_error) <= angle_tolerance))
+            break;
+
+        float dt = loop_timer.get();
+        loop_timer.reset();
+
+        // straight at the target, its speed from the distance left and the turning from the angle left
+        float speed = 0;
+        if (error > 0) {
+            direction_x = (target.x - curr_position.x) / error;
+            direction_y = (target.y - curr_position.y) / error;
+            speed = this->pid_controller->calculate(start_distance, start_distance - error, dt, false);
+            if (exit_speed > 0)
+                speed = std::fmax(speed, exit_speed);
+        }
+        float turn = angular_pid.calculate(total_angle, total_angle - heading_error, dt, false);
+
+        knights::ChassisSpeeds speeds = knights::ChassisSpeeds::from_field(direction_x * speed, direction_y * speed, turn, curr_position.heading);
+        holonomic->move(speeds.forward, speeds.left, speeds.angular);
+
+        pros::delay(10);
+    }
+
+    // stop, or keep driving towards where the target was - always stop if cancelled
+    if (this->cancel_requested || exit_speed == 0)
+        holonomic->stop();
+    else {
+        knights::ChassisSpeeds speeds = knights::ChassisSpeeds::from_field(direction_x * exit_speed, direction_y * exit_speed, 0,
+            this->chassis->get_position().heading);
+        holonomic->move(speeds.forward, speeds.left, 0);
+    }
+}
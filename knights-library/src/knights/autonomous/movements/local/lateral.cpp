@@ -5,21 +5,37 @@
 #include "knights/robot/drivetrain.h"
 
 #include "knights/util/calculation.h"
+#include "knights/util/timer.h"
 #include "pros/motors.h"
 #include "pros/rtos.hpp"
 
-void knights::RobotController::lateral_move(const float distance, const float end_tolerance, float timeout) {
-    if (this->in_motion) return;
-    this->in_motion = true;
-
-    this->chassis->drivetrain->right_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
-    this->chassis->drivetrain->left_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+void knights::RobotController::lateral_move(const float distance, const float end_tolerance, float timeout, float exit_velocity, bool async,
+    knights::ExitCondition exit_condition) {
+    if (async) {
+        this->run_async([=, this]() { this->lateral_move(distance, end_tolerance, timeout, exit_velocity, false, exit_condition); });
+        return;
+    }
+    this->start_motion();
 
     // lateral move the chassis of a robot
     if (this->chassis->drivetrain != nullptr) {
         // move function for differential drive
-        float speed,error;
-        float prev_error = distance; float total_error = 0.0;
+        this->chassis->drivetrain->right_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+        this->chassis->drivetrain->left_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+
+        float speed;
+
+        // clear the integral and derivative left from the last movement
+        this->pid_controller->reset();
+        knights::Timer loop_timer;
+
+        // exit conditions replace the end tolerance and the minimum speed check when any are given
+        bool use_exit = exit_condition.enabled();
+        exit_condition.reset();
+        knights::Timer timer;
+
+        // slowest speed to drive at when carrying velocity into the next movement
+        float exit_speed = fabsf(exit_velocity) * 127.0 / this->chassis->drivetrain->max_velocity();
 
         if (this->use_motor_encoders) {
             // reset motor encoders to 0
@@ -35,22 +51,24 @@ void knights::RobotController::lateral_move(const float distance, const float en
             float right_pos = knights::avg(this->chassis->drivetrain->right_mtrs->get_position_all());
             float left_pos = knights::avg(this->chassis->drivetrain->left_mtrs->get_position_all());
 
-            while(fabsf((right_pos + left_pos)/2) < fabsf(desired_position)) {
-                // decrease timeout and break if went over
-                timeout -= 10;
-                if (timeout < 0) break;
+            while(use_exit || fabsf((right_pos + left_pos)/2) < fabsf(desired_position)) {
+                // break if went over the timeout
+                if (timer.get() > timeout || this->cancel_requested) break;
 
-                // calculate error, convert position to distance so tuning is the same
-                error = this->chassis->drivetrain->position_to_distance(fabsf(desired_position) - fabsf((right_pos + left_pos)/2));
+                // distance driven towards the target, goes past it if the robot overshoots
+                float travelled = this->chassis->drivetrain->position_to_distance((right_pos + left_pos)/2) * knights::signum(distance);
+                this->update_progress(travelled, travelled / fabsf(distance));
 
-                // integrate error
-                total_error += error;
+                float velocity = this->chassis->get_measured_velocity().forward;
+                if (use_exit && exit_condition.update(fabsf(distance) - travelled, velocity, timer.get())) break;
 
-                // use pid formula to calculate speed
-                speed = this->pid_controller->update(error, total_error, prev_error) * knights::signum(distance);
-
-                // save previous error
-                prev_error = error;
+                // use pid formula to calculate speed, positions are converted to distance so tuning is the same
+                float dt = loop_timer.get();
+                loop_timer.reset();
+                speed = this->pid_controller->calculate(fabsf(distance), travelled, dt);
+                if (exit_speed > 0)
+                    speed = std::fmax(speed, exit_speed);
+                speed *= knights::signum(distance);
 
                 // update positions of motors
                 right_pos = knights::avg(this->chassis->drivetrain->right_mtrs->get_position_all());
@@ -64,35 +82,41 @@ void knights::RobotController::lateral_move(const float distance, const float en
             }
         } else {
             // create a variable representing the desired position
-            Pos desired_position(cos(this->chassis->curr_position.heading) * distance + this->chassis->curr_position.x, 
-                sin(this->chassis->curr_position.heading) * distance + this->chassis->curr_position.y, this->chassis->curr_position.heading);
+            Pos start_position = this->chassis->get_position();
+            Pos desired_position(cos(start_position.heading) * distance + start_position.x, 
+                sin(start_position.heading) * distance + start_position.y, start_position.heading);
             
-            while (knights::distance_btwn(this->chassis->curr_position, desired_position) > end_tolerance || 
-                knights::distance_btwn(this->chassis->prev_position, desired_position) < knights::distance_btwn(this->chassis->curr_position, desired_position)) {
-                // decrease timeout and break if went over
-                timeout -= 10;
-                if (timeout < 0) break;
+            while (use_exit || this->not_arrived(desired_position, end_tolerance)) {
+                // break if went over the timeout
+                if (timer.get() > timeout || this->cancel_requested) break;
 
-                // calculate error
-                error = knights::distance_btwn(this->chassis->curr_position, desired_position);
+                // one snapshot per loop, so every calculation uses the same odometry update
+                Pos curr_position = this->chassis->get_position();
 
-                // integrate error
-                total_error += error;
+                float travelled = knights::distance_btwn(start_position, curr_position);
+                this->update_progress(travelled, travelled / fabsf(distance));
 
-                // use pid formula to calculate speed
-                speed = this->pid_controller->update(error, total_error, prev_error) * knights::signum(distance);
+                // distance driven along the starting heading, goes past the target if the robot overshoots
+                float driven = ((curr_position.x - start_position.x) * cos(start_position.heading) +
+                    (curr_position.y - start_position.y) * sin(start_position.heading)) * knights::signum(distance);
 
-                // printf("ptg,%lf,%d,\n", error, pros::millis());
+                float velocity = this->chassis->get_measured_velocity().forward;
+                if (use_exit && exit_condition.update(fabsf(distance) - driven, velocity, timer.get())) break;
 
-                if (fabs(speed) <= this->pid_controller->min_velocity) {
+                // use pid formula to calculate speed
+                float dt = loop_timer.get();
+                loop_timer.reset();
+                speed = this->pid_controller->calculate(fabsf(distance), driven, dt);
+                if (exit_speed > 0)
+                    speed = std::fmax(speed, exit_speed);
+                speed *= knights::signum(distance);
+
+                if (!use_exit && fabs(speed) <= this->pid_controller->min_velocity && exit_speed == 0) {
                     break;
                 }
 
-                // save previous error
-                prev_error = error;
-
                 // --- EXPERIMENTAL
-                float angular_curve = curvature(this->chassis->curr_position, desired_position);
+                float angular_curve = curvature(curr_position, desired_position);
                 
                 // calculate right and left speed based on curvature
                 float r_speed = speed * (2 - angular_curve * this->chassis->drivetrain->track_width) / 2;
@@ -114,13 +138,21 @@ void knights::RobotController::lateral_move(const float distance, const float en
 
         }
 
-        this->chassis->drivetrain->right_mtrs->move(0);
-        this->chassis->drivetrain->left_mtrs->move(0);
+        // stop, or keep driving into the next movement - always stop if cancelled
+        if (this->cancel_requested || exit_speed == 0)
+            this->chassis->drivetrain->stop();
+        else
+            this->chassis->drivetrain->velocity_command(exit_speed * knights::signum(distance), exit_speed * knights::signum(distance));
+
+    } else if (this->chassis->holonomic != nullptr) {
+        // holonomic drives move along their heading with odometry, holding the heading
+        Pos start_position = this->chassis->get_position();
+        Pos desired_position(cos(start_position.heading) * distance + start_position.x,
+            sin(start_position.heading) * distance + start_position.y, start_position.heading);
 
-    } else {
-        // holomic lateral movement code - not done yet
+        this->holonomic_move(desired_position, 0, end_tolerance, HOLONOMIC_HEADING_TOLERANCE, timeout, exit_velocity, exit_condition);
     }
 
-    this->in_motion = false;
+    this->end_motion();
     return;
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "knights/autonomous/controller.h"
+#include "knights/autonomous/pid.h"
+#include "knights/autonomous/profile.h"
+
+#include "knights/robot/chassis.h"
+#include "knights/robot/drivetrain.h"
+
+#include "knights/util/calculation.h"
+#include "knights/util/timer.h"
+#include "pros/motors.h"
+#include "pros/rtos.hpp"
+
+void knights::RobotController::profiled_lateral_move(const float distance, float max_velocity, float max_acceleration, float max_jerk,
+    float end_tolerance, float timeout, float exit_velocity, bool async, knights::ExitCondition exit_condition) {
+    if (async) {
+        this->run_async([=, this]() {
+            this->profiled_lateral_move(distance, max_velocity, max_acceleration, max_jerk, end_tolerance, timeout, exit_velocity, false, exit_condition);
+        });
+        return;
+    }
+    this->start_motion();
+
+    if (this->chassis->holonomic != nullptr) {
+        // holonomic drives move along their heading with odometry like lateral_move, holding the heading - without a profile
+        Pos start_position = this->chassis->get_position();
+        Pos desired_position(cos(start_position.heading) * distance + start_position.x,
+            sin(start_position.heading) * distance + start_position.y, start_position.heading);
+
+        this->holonomic_move(desired_position, 0, end_tolerance, HOLONOMIC_HEADING_TOLERANCE, timeout, exit_velocity, exit_condition);
+        this->end_motion();
+        return;
+    }
+    if (this->chassis->drivetrain == nullptr) {
+        this->end_motion();
+        return;
+    }
+
+    knights::Drivetrain *drivetrain = this->chassis->drivetrain;
+
+    drivetrain->right_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+    drivetrain->left_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_BRAKE);
+
+    // plan from the velocity the robot already has, so a chained movement carries on without a jump
+    float start_velocity = std::fmax(this->chassis->get_measured_velocity().forward * knights::signum(distance), 0.0f);
+    knights::MotionProfile profile(distance, max_velocity, max_acceleration, max_jerk, start_velocity, fabsf(exit_velocity));
+
+    Pos start_position = this->chassis->get_position();
+    if (this->use_motor_encoders) {
+        drivetrain->right_mtrs->set_encoder_units(pros::motor_encoder_units_e_t::E_MOTOR_ENCODER_DEGREES);
+        drivetrain->left_mtrs->set_encoder_units(pros::motor_encoder_units_e_t::E_MOTOR_ENCODER_DEGREES);
+        drivetrain->right_mtrs->tare_position();
+        drivetrain->left_mtrs->tare_position();
+    }
+
+    // the PID only corrects what the feedforward misses, its output is scaled from motor units to inches per second
+    float pid_scale = drivetrain->max_velocity() / 127.0;
+    this->pid_controller->reset();
+    knights::Timer loop_timer;
+
+    // exit conditions replace the end tolerance when any are given
+    bool use_exit = exit_condition.enabled();
+    exit_condition.reset();
+    knights::Timer timer;
+
+    while (!this->cancel_requested) {
+        float elapsed = timer.get();
+        if (elapsed > timeout) break;
+
+        // distance driven towards the target, from the encoders or along the starting heading
+        float driven;
+        if (this->use_motor_encoders)
+            driven = drivetrain->position_to_distance((knights::avg(drivetrain->right_mtrs->get_position_all()) +
+                knights::avg(drivetrain->left_mtrs->get_position_all())) / 2);
+        else
+            driven = (this->chassis->get_position().x - start_position.x) * cos(start_position.heading) +
+                (this->chassis->get_position().y - start_position.y) * sin(start_position.heading);
+
+        if (distance != 0)
+            this->update_progress(fabsf(driven), driven / distance);
+
+        float remaining = (distance - driven) * knights::signum(distance);
+        float velocity = this->chassis->get_measured_velocity().forward;
+        bool profile_done = elapsed / 1000 >= profile.duration();
+
+        if (use_exit) {
+            if (exit_condition.update(remaining, velocity, elapsed)) break;
+        } else if (profile_done && (exit_velocity != 0 || fabsf(remaining) <= end_tolerance))
+            break;
+
+        // follow the profile with feedforward, and correct the position error with PID
+        knights::ProfileState desired = profile.at(elapsed / 1000);
+
+        float dt = loop_timer.get();
+        loop_timer.reset();
+        float correction = this->pid_controller->calculate(desired.position, driven, dt, false) * pid_scale;
+
+        drivetrain->feedforward_command(desired.velocity + correction, desired.velocity + correction, desired.acceleration, desired.acceleration);
+
+        pros::delay(10);
+    }
+
+    // stop, or keep driving into the next movement - always stop if cancelled
+    if (this->cancel_requested || exit_velocity == 0)
+        drivetrain->stop();
+    else
+        drivetrain->feedforward_command(fabsf(exit_velocity) * knights::signum(distance), fabsf(exit_velocity) * knights::signum(distance));
+
+    this->end_motion();
+    return;
+}
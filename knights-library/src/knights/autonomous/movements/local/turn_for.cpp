@@ -4,17 +4,29 @@
 #include "knights/robot/chassis.h"
 
 #include "knights/util/calculation.h"
+#include "knights/util/timer.h"
 
-void knights::RobotController::turn_for(const float angle, float end_tolerance, float timeout, bool rad) {
+void knights::RobotController::turn_for(const float angle, float end_tolerance, float timeout, bool rad, bool async, knights::ExitCondition exit_condition) {
     // turn the robot a certain amount of degrees, positive is left, negative is right
 
-    if (this->in_motion) return;
-    this->in_motion = true;
+    if (async) {
+        this->run_async([=, this]() { this->turn_for(angle, end_tolerance, timeout, rad, false, exit_condition); });
+        return;
+    }
+    this->start_motion();
 
     if (this->chassis->drivetrain != nullptr) {
         
         float speed,error;
-        float prev_error = fabsf(to_rad(angle)); float total_error = 0.0;
+
+        // clear the integral and derivative left from the last movement
+        this->pid_controller->reset();
+        knights::Timer loop_timer;
+
+        // exit conditions replace the end tolerance and the minimum speed check when any are given
+        bool use_exit = exit_condition.enabled();
+        exit_condition.reset();
+        knights::Timer timer;
 
         if (this->use_motor_encoders) {
             // use circumfrence of circle divided by 360 times degrees to calculate how much one side would need to rotate
@@ -32,23 +44,22 @@ void knights::RobotController::turn_for(const float angle, float end_tolerance,
             float right_pos = knights::avg(this->chassis->drivetrain->right_mtrs->get_position_all());
             float left_pos = knights::avg(this->chassis->drivetrain->left_mtrs->get_position_all());
 
-            while(fabsf((right_pos + left_pos)/2) < fabsf(desired_position)) {
-                // decrease timeout and break if went over
-                timeout -= 10;
-                if (timeout < 0) 
+            while(use_exit || fabsf((right_pos + left_pos)/2) < fabsf(desired_position)) {
+                // break if went over the timeout
+                if (timer.get() > timeout || this->cancel_requested) 
                     break;
 
-                // calculate error, convert position to distance so tuning is the same
-                error = this->chassis->drivetrain->position_to_distance(fabsf(desired_position) - fabsf((right_pos + left_pos)/2));
+                float turned = fabsf((right_pos + left_pos)/2) / fabsf(desired_position);
+                this->update_progress(turned * fabsf(angle), turned);
 
-                // integrate error
-                total_error += error;
+                float angular_velocity = this->chassis->get_measured_velocity().angular;
+                if (use_exit && exit_condition.update((1 - turned) * fabsf(angle), to_deg(angular_velocity), timer.get())) break;
 
-                // use pid formula to calculate speed
-                speed = this->pid_controller->update(error, total_error, prev_error);
-
-                // save previous error
-                prev_error = error;
+                // use pid formula to calculate speed, convert position to distance so tuning is the same
+                float dt = loop_timer.get();
+                loop_timer.reset();
+                speed = this->pid_controller->calculate(this->chassis->drivetrain->position_to_distance(fabsf(desired_position)),
+                    this->chassis->drivetrain->position_to_distance(fabsf((right_pos + left_pos)/2)), dt);
 
                 // update positions of motors
                 right_pos = knights::avg(this->chassis->drivetrain->right_mtrs->get_position_all());
@@ -61,32 +72,44 @@ void knights::RobotController::turn_for(const float angle, float end_tolerance,
                 pros::delay(10);
             }
 
+            // stop the robot
+            this->chassis->drivetrain->stop();
+
         } else {
             float desired_angle;
 
             if (rad) // inputs provided in rads
-                desired_angle = normalize_angle(this->chassis->curr_position.heading + (angle), true);
+                desired_angle = normalize_angle(this->chassis->get_position().heading + (angle), true);
             else {// inputs provided in degrees
                 end_tolerance = to_rad(end_tolerance);
-                desired_angle = normalize_angle(this->chassis->curr_position.heading + to_rad(angle), true);
+                desired_angle = normalize_angle(this->chassis->get_position().heading + to_rad(angle), true);
             }
 
-            while(std::abs(min_angle(this->chassis->curr_position.heading, desired_angle, true)) > end_tolerance) {
+            float total_angle = rad ? fabsf(angle) : to_rad(fabsf(angle));
+            error = total_angle;
+
+            while(use_exit || std::abs(min_angle(this->chassis->get_position().heading, desired_angle, true)) > end_tolerance) {
 
                 // if we are over alloted time, end the function
-                timeout -= 10;
-                if (timeout < 0)
+                if (timer.get() > timeout || this->cancel_requested)
                     break;
 
-                // calculate using PID formula
-                error = std::abs(min_angle(this->chassis->curr_position.heading, desired_angle, true));
-                total_error += error;
-                speed = this->pid_controller->update(error, total_error, prev_error);
-                prev_error = error;
+                // angle left to turn, kept continuous with last loop so it goes negative if the robot turns past the target
+                error = knights::unwrap_angle(signum(angle) * min_angle(this->chassis->get_position().heading, desired_angle, true), error);
+
+                float angular_velocity = this->chassis->get_measured_velocity().angular;
+                if (use_exit && exit_condition.update(to_deg(error), to_deg(angular_velocity), timer.get())) break;
 
-                this->chassis->drivetrain->velocity_command(-signum(angle) * speed, signum(angle) * speed);
+                if (total_angle > 0)
+                    this->update_progress(to_deg(std::fmax(total_angle - error, 0.0f)), 1 - error / total_angle);
+                float dt = loop_timer.get();
+                loop_timer.reset();
+                speed = this->pid_controller->calculate(total_angle, total_angle - error, dt);
 
-                if (fabs(speed) < this->pid_controller->get_min_speed()) {
+                // positive angles turn left, the same way as with the motor encoders
+                this->chassis->drivetrain->velocity_command(signum(angle) * speed, -signum(angle) * speed);
+
+                if (!use_exit && fabs(speed) <= this->pid_controller->get_min_speed()) {
                     break;
                 }
 
@@ -94,13 +117,18 @@ void knights::RobotController::turn_for(const float angle, float end_tolerance,
             }
 
             // stop the robot
-            this->chassis->drivetrain->velocity_command(0, 0);
+            this->chassis->drivetrain->stop();
             
         }
-    } else {
-        // holonomic code
+    } else if (this->chassis->holonomic != nullptr) {
+        // holonomic drives turn in place with odometry, holding their position
+        float turn_angle = rad ? angle : to_rad(angle);
+        Pos desired_position = this->chassis->get_position();
+        desired_position.heading = normalize_angle(desired_position.heading + turn_angle, true);
+
+        this->holonomic_move(desired_position, turn_angle, HOLONOMIC_POSITION_TOLERANCE, rad ? end_tolerance : to_rad(end_tolerance), timeout, 0, exit_condition);
     }
 
-    this->in_motion = false;
+    this->end_motion();
     return;
 }
\ No newline at end of file
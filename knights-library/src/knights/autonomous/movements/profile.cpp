@@ -1,74 +1,253 @@
-#include "knights/autonomous/path.h"
 #include "knights/autonomous/profile.h"
 #include "knights/util/calculation.h"
-#include "knights/util/timer.h"
+#include "knights/util/position.h"
+#include "knights/util/route.h"
 
-// MIGHT NOT BE USEFUL
+#include <algorithm>
+#include <cmath>
 
 knights::ProfileTimestamp::ProfileTimestamp(knights::Pos position, float expected_velocity, float time,
-    float right_speed, float left_speed) :
-    position(position), expected_velocity(expected_velocity), time(time), right_speed(right_speed), left_speed(left_speed) {}
+    float right_speed, float left_speed, float angular_velocity, float distance) :
+    position(position), expected_velocity(expected_velocity), time(time), right_speed(right_speed), left_speed(left_speed),
+    angular_velocity(angular_velocity), distance(distance) {}
 
-knights::ProfileGenerator::ProfileGenerator(knights::Drivetrain* drivetrain) :
-    drivetrain(drivetrain) {}
+knights::MotionProfile::MotionProfile(float distance, float max_velocity, float max_acceleration, float max_jerk,
+    float start_velocity, float end_velocity) {
 
-knights::ProfileGenerator::ProfileGenerator(float rpm, float wheel_diameter) :
-    rpm(rpm), wheel_diameter(wheel_diameter) {}
+    this->direction = (distance < 0) ? -1.0 : 1.0;
+    this->start_velocity = std::fmax(start_velocity, 0.0f);
 
+    if (max_velocity <= 0 || max_acceleration <= 0)
+        return;
 
-// NOT CURRENTLY OPERATIONAL
-std::vector<knights::ProfileTimestamp> knights::ProfileGenerator::generate_profile(knights::Route route, knights::Pos start, knights::Drivetrain* drivetrain, 
-    float lookahead, float speed_max, float speed_min, float interval) {
+    // the S-curve averages the trapezoid over jerk_time, which adds distance while moving at the end velocities
+    this->jerk_time = (max_jerk > 0) ? max_acceleration / max_jerk : 0.0;
 
-    std::vector<knights::ProfileTimestamp> output;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        float v0 = this->start_velocity;
+        float total = std::fabs(distance) - (v0 + std::fmax(end_velocity, 0.0f)) * this->jerk_time / 2;
+        if (total < 0) {
+            // too short to smooth, plan a trapezoid
+            this->jerk_time = 0;
+            total = std::fabs(distance);
+        }
+        this->distance = total;
+
+        // can't speed up to the end velocity in the distance
+        float v1 = std::fmin(std::fmin(std::fmax(end_velocity, 0.0f), max_velocity), std::sqrt(v0 * v0 + 2 * max_acceleration * total));
+
+        if (v0 > std::sqrt(v1 * v1 + 2 * max_acceleration * total)) {
+            // too fast to slow down in time, slow down the whole way as hard as needed
+            this->peak_velocity = v0;
+            this->first_acceleration = 0;
+            this->first_time = 0; this->cruise_time = 0;
+            this->last_acceleration = (total > 1e-6) ? -(v0 * v0 - v1 * v1) / (2 * total) : -max_acceleration;
+            this->last_time = (v0 - v1) / -this->last_acceleration;
+        } else {
+            // speed up (or slow down if starting over the max) to the peak, cruise, then slow down to the end velocity
+            this->peak_velocity = std::fmin(max_velocity, std::sqrt((2 * max_acceleration * total + v0 * v0 + v1 * v1) / 2));
+            this->first_acceleration = (this->peak_velocity >= v0) ? max_acceleration : -max_acceleration;
+            this->first_time = std::fabs(this->peak_velocity - v0) / max_acceleration;
+            this->last_acceleration = -max_acceleration;
+            this->last_time = (this->peak_velocity - v1) / max_acceleration;
+        }
 
-    int time = 0;
+        this->end_velocity = v1;
+        this->first_distance = v0 * this->first_time + this->first_acceleration * this->first_time * this->first_time / 2;
+        float last_distance = this->peak_velocity * this->last_time + this->last_acceleration * this->last_time * this->last_time / 2;
+        this->cruise_distance = std::fmax(total - this->first_distance - last_distance, 0.0f);
+        this->cruise_time = (this->peak_velocity > 1e-6) ? this->cruise_distance / this->peak_velocity : 0.0;
+        this->end_position = this->first_distance + this->cruise_distance + last_distance;
+
+        // going straight from speeding up to slowing down doubles the jerk, so use a window twice as wide
+        if (this->jerk_time > 0 && attempt == 0 && this->cruise_time < this->jerk_time)
+            this->jerk_time = 2 * max_acceleration / max_jerk;
+        else
+            break;
+    }
+}
+
+float knights::MotionProfile::trapezoid_position(float time) const {
+    float t1 = this->first_time, t2 = t1 + this->cruise_time, t3 = t2 + this->last_time;
+
+    if (time < 0)
+        return this->start_velocity * time;
+    if (time < t1)
+        return this->start_velocity * time + this->first_acceleration * time * time / 2;
+    if (time < t2)
+        return this->first_distance + this->peak_velocity * (time - t1);
+    if (time < t3) {
+        float t = time - t2;
+        return this->first_distance + this->cruise_distance + this->peak_velocity * t + this->last_acceleration * t * t / 2;
+    }
+    return this->end_position + this->end_velocity * (time - t3);
+}
+
+float knights::MotionProfile::trapezoid_velocity(float time) const {
+    float t1 = this->first_time, t2 = t1 + this->cruise_time, t3 = t2 + this->last_time;
+
+    if (time < 0)
+        return this->start_velocity;
+    if (time < t1)
+        return this->start_velocity + this->first_acceleration * time;
+    if (time < t2)
+        return this->peak_velocity;
+    if (time < t3)
+        return this->peak_velocity + this->last_acceleration * (time - t2);
+    return this->end_velocity;
+}
+
+float knights::MotionProfile::trapezoid_position_integral(float time) const {
+    float t1 = this->first_time, t2 = t1 + this->cruise_time, t3 = t2 + this->last_time;
+    float v0 = this->start_velocity, a1 = this->first_acceleration, a3 = this->last_acceleration, peak = this->peak_velocity;
+
+    if (time < 0)
+        return v0 * time * time / 2;
+
+    // integral of each phase, added up to the phase the time is in
+    float t = std::fmin(time, t1);
+    float integral = v0 * t * t / 2 + a1 * t * t * t / 6;
+    if (time <= t1)
+        return integral;
+
+    t = std::fmin(time, t2) - t1;
+    integral += this->first_distance * t + peak * t * t / 2;
+    if (time <= t2)
+        return integral;
+
+    t = std::fmin(time, t3) - t2;
+    integral += (this->first_distance + this->cruise_distance) * t + peak * t * t / 2 + a3 * t * t * t / 6;
+    if (time <= t3)
+        return integral;
+
+    t = time - t3;
+    return integral + this->end_position * t + this->end_velocity * t * t / 2;
+}
+
+knights::ProfileState knights::MotionProfile::at(float time) const {
+    knights::ProfileState state;
+
+    if (this->jerk_time > 0) {
+        // average the trapezoid over the window before this time, shifted so the profile starts at 0
+        float window = this->jerk_time;
+        state.position = (this->trapezoid_position_integral(time) - this->trapezoid_position_integral(time - window)) / window
+            + this->start_velocity * window / 2;
+        state.velocity = (this->trapezoid_position(time) - this->trapezoid_position(time - window)) / window;
+        state.acceleration = (this->trapezoid_velocity(time) - this->trapezoid_velocity(time - window)) / window;
+    } else {
+        float end = this->first_time + this->cruise_time + this->last_time;
+        state.position = this->trapezoid_position(time);
+        state.velocity = this->trapezoid_velocity(time);
+        if (time < 0 || time >= end)
+            state.acceleration = 0;
+        else if (time < this->first_time)
+            state.acceleration = this->first_acceleration;
+        else if (time < this->first_time + this->cruise_time)
+            state.acceleration = 0;
+        else
+            state.acceleration = this->last_acceleration;
+    }
 
-    knights::Pos curr = start;
+    state.position *= this->direction;
+    state.velocity *= this->direction;
+    state.acceleration *= this->direction;
+    return state;
+}
 
-    int i = 0;
-    knights::Pos target = route.positions[i];
+float knights::MotionProfile::duration() const {
+    return this->first_time + this->cruise_time + this->last_time + this->jerk_time;
+}
 
-    while (distance_btwn(curr, route.positions[route.positions.size()-1]) > 10.0) { // TODO: make new var for end tolerance
-        // route
+knights::ProfileGenerator::ProfileGenerator(float max_velocity, float max_acceleration, float max_lateral_acceleration, float track_width) :
+    max_velocity(max_velocity), max_acceleration(max_acceleration), max_lateral_acceleration(max_lateral_acceleration), track_width(track_width) {}
 
-        while (knights::distance_btwn(curr, route.positions[i]) < lookahead && i < route.positions.size()-1) {
-            i++;
-            target = route.positions[i];
-        }
+std::vector<float> knights::ProfileGenerator::velocity_limits(const knights::Route &route) {
+    std::vector<float> limits(route.positions.size(), this->max_velocity);
 
-        float speed_curvature = 0.001;
-        if (i < route.positions.size() - 2) {
-            speed_curvature += knights::curvature(curr, target, route.positions[i + 1]);
-        }
+    for (int i = 0; i < limits.size(); i++) {
+        float curvature = fabs(route.curvature_at(i));
 
-        float curr_speed = std::max(std::min(3/speed_curvature, speed_max), speed_min);
+        if (curvature < 1e-6)
+            continue;
 
-        float angular_curvature = knights::curvature(curr, target);
+        // the outside wheels go faster than the center of the robot in a turn, keep them under the max
+        limits[i] = this->max_velocity / (1 + curvature * this->track_width / 2);
 
-        float r_speed = curr_speed * (2 - angular_curvature * drivetrain->track_width) / 2;
-        float l_speed = curr_speed * (2 + angular_curvature * drivetrain->track_width) / 2;
+        // v^2 * curvature is the sideways acceleration, keep it under the limit so the robot doesn't slide
+        if (this->max_lateral_acceleration > 0)
+            limits[i] = std::fmin(limits[i], std::sqrt(this->max_lateral_acceleration / curvature));
+    }
 
-        // normalize on ratio - maybe remove
-        float max_curr_speed = std::fmax(fabs(r_speed), fabs(l_speed)) / 127.0;
-        if (max_curr_speed > 1) {
-            r_speed /= max_curr_speed;
-            l_speed /= max_curr_speed;
-        }
+    return limits;
+}
+
+std::vector<knights::ProfileTimestamp> knights::ProfileGenerator::generate_profile(const knights::Route &route, float interval,
+    float start_velocity, float end_velocity) {
+
+    std::vector<knights::ProfileTimestamp> output;
+
+    if (route.positions.size() < 2 || !route.geometry_valid() || interval <= 0)
+        return output;
+
+    int size = route.positions.size();
+    std::vector<float> velocities = this->velocity_limits(route);
+
+    velocities.front() = std::fmin(velocities.front(), start_velocity);
+    velocities.back() = std::fmin(velocities.back(), end_velocity);
+
+    // forward pass, limit how fast the robot can speed up: v1^2 = v0^2 + 2 * a * d
+    for (int i = 0; i < size - 1; i++) {
+        velocities[i+1] = std::fmin(velocities[i+1],
+            std::sqrt(velocities[i] * velocities[i] + 2 * this->max_acceleration * route.segment_lengths[i]));
+    }
+
+    // backward pass, limit how fast the robot can slow down
+    for (int i = size - 2; i >= 0; i--) {
+        velocities[i] = std::fmin(velocities[i],
+            std::sqrt(velocities[i+1] * velocities[i+1] + 2 * this->max_acceleration * route.segment_lengths[i]));
+    }
+
+    // time to reach each position, acceleration is constant along each segment
+    std::vector<float> times(size, 0.0);
+    for (int i = 0; i < size - 1; i++) {
+        float average_velocity = (velocities[i] + velocities[i+1]) / 2;
+        float segment_time = (average_velocity > 1e-6) ? route.segment_lengths[i] / average_velocity : 0.0;
+        times[i+1] = times[i] + segment_time * 1000; // seconds to milliseconds
+    }
+
+    // sample the profile every interval
+    int segment = 0;
+    for (float time = 0; ; time += interval) {
+        bool last = time >= times.back();
+        if (last)
+            time = times.back();
+
+        while (segment < size - 2 && times[segment+1] <= time)
+            segment++;
+
+        // time, velocity and acceleration on this segment
+        float seconds = (time - times[segment]) / 1000;
+        float length = route.segment_lengths[segment];
+        float start_vel = velocities[segment];
+        float acceleration = (length > 0) ? (velocities[segment+1] * velocities[segment+1] - start_vel * start_vel) / (2 * length) : 0.0;
 
-        output.emplace_back(curr, curr_speed, time, r_speed, l_speed);
+        float distance = knights::clamp(start_vel * seconds + acceleration * seconds * seconds / 2, 0.0f, length);
+        float velocity = std::fmax(start_vel + acceleration * seconds, 0.0f);
+        float t = (length > 0) ? distance / length : 0.0;
 
-        float linear_speed = ((r_speed + l_speed) / 2) * ((drivetrain->rpm * drivetrain->wheel_diameter / 60000) / 127.0); // TODO: convert to inches per millisecond 
-        float angular_omega = (r_speed - l_speed) * ((drivetrain->rpm * drivetrain->wheel_diameter / 60000) / 127.0) / drivetrain->track_width;
+        knights::Pos position = knights::lerp(route.positions[segment], route.positions[segment+1], t);
+        position.heading = knights::normalize_angle(std::atan2(route.segment_directions[segment].y, route.segment_directions[segment].x));
 
-        curr.x += linear_speed * cosf(curr.heading) * interval; // interval in ms
-        curr.y += linear_speed * sinf(curr.heading) * interval; // interval in ms
-        curr.heading += angular_omega * interval;
+        float curvature = route.curvature_at(segment) * (1 - t) + route.curvature_at(segment + 1) * t;
+        float right_speed = velocity * (1 + curvature * this->track_width / 2);
+        float left_speed = velocity * (1 - curvature * this->track_width / 2);
 
-        curr.heading = normalize_angle(curr.heading);
+        output.emplace_back(position, velocity, time, right_speed, left_speed, velocity * curvature,
+            route.arc_lengths[segment] + distance);
 
-        time += interval;
+        if (last)
+            break;
     }
 
     return output;
-}
\ No newline at end of file
+}
@@ -4,62 +4,103 @@
 #include "knights/robot/drivetrain.h"
 #include "knights/robot/position_tracker.h"
 
+#include "knights/autonomous/ekf.h"
+
 #include "knights/util/calculation.h"
 
 void knights::RobotChassis::update_position() {
+    // every sensor is read once at the start of the update, and everything else is given the same readings
+    SensorFrame frame;
+    this->read_sensors(frame);
+    if (this->odometry != nullptr)
+        this->update_odometry(frame);
+    else
+        this->update_position(frame);
+}
+
+void knights::RobotChassis::update_odometry(knights::SensorFrame &frame) {
+    this->position_mutex.take(TIMEOUT_MAX);
+
+    Pos position = this->curr_position;
+    MotionIncrement increment;
+    bool moved = this->odometry->update(frame, position, increment);
+    this->sensor_state.write(frame);
+    if (!moved) {
+        this->position_mutex.give();
+        return;
+    }
 
-    float deltaRight, deltaLeft, deltaFront, deltaBack;
+    this->prev_position = this->curr_position;
+    if (this->estimator != nullptr)
+        this->estimate_position(frame, increment.forward, increment.lateral, (increment.heading_variance >= 0) ? increment.heading : NAN);
+    else
+        this->curr_position = position;
+
+    this->publish_position(true, frame.time);
+    this->position_mutex.give();
+}
 
-    float newHeading, averageHeading, deltaHeading, deltaYOffset;
+void knights::RobotChassis::update_position(const knights::SensorFrame &frame) {
+    // set_position can't change the position in the middle of an update, it would be overwritten
+    this->position_mutex.take(TIMEOUT_MAX);
+    this->sensor_state.write(frame);
 
-    float deltaX, deltaY, localX, localY;
+    float deltaRight = 0, deltaLeft = 0, deltaFront = 0, deltaBack = 0;
 
-    if (this->pos_trackers->right_tracker != nullptr) {
-        deltaRight = this->pos_trackers->right_tracker->get_distance_travelled() - this->prevRight;
-        this->prevRight = this->pos_trackers->right_tracker->get_distance_travelled(); 
+    // without a way to measure the heading it stays the same
+    float newHeading = curr_position.heading, averageHeading, deltaHeading = 0, deltaYOffset = 0;
+
+    float deltaX, deltaY = 0, localX, localY;
+
+    if (!std::isnan(frame.right)) {
+        deltaRight = frame.right - this->prevRight;
+        this->prevRight = frame.right;
     }
-    if (this->pos_trackers->left_tracker != nullptr) {
-        deltaLeft = this->pos_trackers->left_tracker->get_distance_travelled() - this->prevLeft;
-        this->prevLeft = this->pos_trackers->left_tracker->get_distance_travelled(); 
+    if (!std::isnan(frame.left)) {
+        deltaLeft = frame.left - this->prevLeft;
+        this->prevLeft = frame.left;
     }
-    if (this->pos_trackers->front_tracker != nullptr) {
-        deltaFront = this->pos_trackers->front_tracker->get_distance_travelled() - this->prevFront;
-        this->prevFront = this->pos_trackers->front_tracker->get_distance_travelled(); 
+    if (!std::isnan(frame.front)) {
+        deltaFront = frame.front - this->prevFront;
+        this->prevFront = frame.front;
     }
-    if (this->pos_trackers->back_tracker != nullptr) {
-        deltaBack = this->pos_trackers->back_tracker->get_distance_travelled() - this->prevBack;
-        this->prevBack = this->pos_trackers->back_tracker->get_distance_travelled();
+    if (!std::isnan(frame.back)) {
+        deltaBack = frame.back - this->prevBack;
+        this->prevBack = frame.back;
     }
 
-    // printf("right odom: %lf %lf\n", this->pos_trackers->right_tracker->get_distance_travelled(), this->prevRight);
-    // printf("imu %lf %lf\n", this->pos_trackers->inertial->get_heading(), prev_position.heading);
+    // printf("right odom: %lf %lf\n", frame.right, this->prevRight);
+    // printf("imu %lf %lf\n", frame.imu_heading, prev_position.heading);
 
-    if (deltaRight && deltaLeft) {
+    bool tracker_pair = !std::isnan(frame.right) && !std::isnan(frame.left);
+    if (tracker_pair) {
         deltaHeading = ((deltaLeft - deltaRight)/(this->pos_trackers->right_tracker->get_offset() + this->pos_trackers->left_tracker->get_offset()));
         newHeading = curr_position.heading - deltaHeading;
-    } else if (this->pos_trackers->inertial != nullptr) {
+    } else if (!std::isnan(frame.imu_heading)) {
         // // old 11.15
         // newHeading = knights::normalize_angle(-knights::to_rad(this->pos_trackers->inertial->get_heading()-180), true);
         
         // new 11.15
-        newHeading = knights::normalize_angle((knights::to_rad(-this->pos_trackers->inertial->get_heading())), true);
+        newHeading = knights::normalize_angle((knights::to_rad(-frame.imu_heading)), true);
         
         deltaHeading = newHeading - prev_position.heading;
     }
 
-    if (std::isnan(newHeading) || std::isinf(newHeading)) 
+    if (std::isnan(newHeading) || std::isinf(newHeading)) {
+        this->position_mutex.give();
         return;
+    }
 
     averageHeading = normalize_angle(newHeading - (deltaHeading / 2), true);
 
     // calculate change in x and y
-    if (this->pos_trackers->right_tracker != nullptr && this->pos_trackers->left_tracker != nullptr) {
+    if (tracker_pair) {
         deltaY = (deltaRight+deltaLeft)/2;
         deltaYOffset = (this->pos_trackers->right_tracker->get_offset() + this->pos_trackers->left_tracker->get_offset())/2;
-    } else if (this->pos_trackers->right_tracker != nullptr) {
+    } else if (!std::isnan(frame.right)) {
         deltaY = deltaRight;
         deltaYOffset = this->pos_trackers->right_tracker->get_offset();
-    } else if (this->pos_trackers->left_tracker != nullptr) {
+    } else if (!std::isnan(frame.left)) {
         deltaY = deltaLeft;
         deltaYOffset = this->pos_trackers->left_tracker->get_offset();
     }
@@ -78,7 +119,8 @@ void knights::RobotChassis::update_position() {
     else {
         const float cnst = 2 * sin(deltaHeading / 2);
         // curved
-        localX = cnst * (deltaX / deltaHeading + this->pos_trackers->back_tracker->get_offset());
+        float deltaXOffset = (this->pos_trackers->back_tracker != nullptr) ? this->pos_trackers->back_tracker->get_offset() : 0;
+        localX = cnst * (deltaX / deltaHeading + deltaXOffset);
         localY = cnst * (deltaY / deltaHeading + deltaYOffset); // using right wheel for vertical tracking
     }
     // printf("lx+y %lf %lf, dPos %lf %lf %lf\n", localX, localY, deltaX, deltaY, deltaHeading);
@@ -89,11 +131,95 @@ void knights::RobotChassis::update_position() {
     // // calculate global y
     // curr_position.y += localX * cos(averageHeading) + localY * -sin(averageHeading);
 
-    // using new bot
-    // calculate global x
-    curr_position.x += localX * -sin(averageHeading) + localY * cos(averageHeading);
-    // calculate global y
-    curr_position.y += localX * cos(averageHeading) + localY * sin(averageHeading);
+    if (this->estimator != nullptr) {
+        // the estimator integrates the position itself, heading from the trackers only if there are two of them
+        this->estimate_position(frame, localY, localX, tracker_pair ? -deltaHeading : NAN);
+    } else {
+        // using new bot
+        // calculate global x
+        curr_position.x += localX * -sin(averageHeading) + localY * cos(averageHeading);
+        // calculate global y
+        curr_position.y += localX * cos(averageHeading) + localY * sin(averageHeading);
+
+        this->curr_position.heading = newHeading;
+    }
+
+    this->publish_position(true, frame.time);
+    this->position_mutex.give();
+}
+
+void knights::RobotChassis::estimate_position(const knights::SensorFrame &frame, float forward, float lateral, float tracker_heading) {
+    const knights::EKFNoise &noise = this->estimator->get_noise();
+    bool inertial = !std::isnan(frame.imu_heading);
+    std::uint32_t time = frame.time;
+
+    if (this->estimator_reset) {
+        this->estimator->reset(this->curr_position);
+        // the IMU's heading is only trusted relative to where it was when the position was set
+        if (inertial)
+            this->imu_heading_offset = this->curr_position.heading - knights::to_rad(-frame.imu_heading);
+        this->estimator_time = time;
+        this->estimator_reset = false;
+        return;
+    }
+
+    float dt = (time - this->estimator_time) / 1000.0;
+    this->estimator_time = time;
+
+    // every source's guess at the motion since the last update, trusted less the further it says the robot moved
+    knights::MotionIncrement increments[4];
+    int amount = 0;
+
+    MotionIncrement &trackers = increments[amount++];
+    trackers.forward = forward;
+    trackers.forward_variance = noise.tracker_variance * fabsf(forward) + noise.minimum_variance;
+    if (!std::isnan(frame.back)) {
+        trackers.lateral = lateral;
+        trackers.lateral_variance = noise.tracker_variance * fabsf(lateral) + noise.minimum_variance;
+    }
+    if (!std::isnan(tracker_heading)) {
+        trackers.heading = tracker_heading;
+        trackers.heading_variance = noise.tracker_heading_variance * fabsf(forward) + noise.minimum_variance;
+    }
+
+    if (inertial && !std::isnan(frame.imu_rate)) {
+        MotionIncrement &imu = increments[amount++];
+        imu.heading = IMU_RATE_DIRECTION * knights::to_rad(frame.imu_rate) * dt;
+        imu.heading_variance = noise.imu_rate_variance;
+    }
+
+    if (!std::isnan(frame.right_velocity) && !std::isnan(frame.left_velocity)) {
+        float right = frame.right_velocity * dt, left = frame.left_velocity * dt;
+        MotionIncrement &motors = increments[amount++];
+        motors.forward = (right + left) / 2;
+        motors.forward_variance = noise.motor_variance * fabsf(motors.forward) + noise.minimum_variance;
+        motors.heading = frame.drive_velocity.angular * dt;
+        motors.heading_variance = noise.motor_heading_variance * (fabsf(right) + fabsf(left)) / 2 + noise.minimum_variance;
+
+        // a differential drive can only slide sideways by slipping, so without a horizontal tracker the sideways motion is about 0
+        if (std::isnan(frame.back)) {
+            MotionIncrement &no_slip = increments[amount++];
+            no_slip.lateral_variance = noise.lateral_variance * fabsf(motors.forward) + noise.minimum_variance;
+        }
+    } else if (this->holonomic != nullptr) {
+        const knights::ChassisSpeeds &speeds = frame.drive_velocity;
+        MotionIncrement &motors = increments[amount++];
+        motors.forward = speeds.forward * dt;
+        motors.lateral = speeds.left * dt;
+        motors.heading = speeds.angular * dt;
+        motors.forward_variance = noise.motor_variance * fabsf(motors.forward) + noise.minimum_variance;
+        motors.lateral_variance = noise.motor_variance * fabsf(motors.lateral) + noise.minimum_variance;
+        motors.heading_variance = noise.motor_heading_variance * (fabsf(motors.forward) + fabsf(motors.lateral)) + noise.minimum_variance;
+    }
+
+    this->estimator->predict(knights::MotionIncrement::fuse(increments, amount));
+
+    // the IMU's heading corrects the drift of the summed increments
+    if (inertial) {
+        float heading = knights::to_rad(-frame.imu_heading) + this->imu_heading_offset;
+        if (!std::isnan(heading) && !std::isinf(heading))
+            this->estimator->update_heading(knights::normalize_angle(heading, true), noise.imu_heading_variance);
+    }
 
-    this->curr_position.heading = newHeading;
+    this->curr_position = this->estimator->get_pose();
 }
@@ -0,0 +1,421 @@
+#include "knights/autonomous/path.h"
+#include "knights/autonomous/profile.h"
+#include "knights/util/position.h"
+#include "knights/util/route.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+knights::RouteAction::RouteAction(knights::action_type type, int route_index, float end_tolerance, int timeout, float lookahead) :
+    type(type), route_index(route_index), end_tolerance(end_tolerance), timeout(timeout), lookahead(lookahead) {}
+
+knights::RouteAction::RouteAction(action_type type, float specific, float end_tolerance, int timeout) :
+    type(type), end_tolerance(end_tolerance), timeout(timeout), specific(specific) {}
+
+knights::RouteAction::RouteAction(action_type type, std::string function_name) :
+    type(type), function_name(function_name) {}
+
+knights::AdvancedRoute::AdvancedRoute() {
+    this->actions = std::vector<knights::RouteAction>();
+    this->routes = std::vector<knights::Route>();
+}
+
+knights::AdvancedRoute::AdvancedRoute(std::vector<Route> routes, std::vector<RouteAction> actions) :
+    routes(std::move(routes)), actions(std::move(actions)) {}
+
+namespace {
+    // whether a motion drives forwards, follow routes are driven backwards with a negative lookahead and lateral moves with a negative distance
+    bool drives_forwards(const knights::RouteAction &action) {
+        if (action.type == knights::action_type::FOLLOW)
+            return action.lookahead >= 0;
+        return action.specific >= 0;
+    }
+}
+
+float knights::AdvancedRoute::entry_velocity(int action_index) const {
+    for (int i = action_index - 1; i >= 0; i--) {
+        if (this->actions[i].next_start != knights::start_condition::IMMEDIATE)
+            return 0.0;
+        if (this->actions[i].type != knights::action_type::COMMAND) {
+            // velocity can't be carried into a motion the other way, it starts from stopped
+            if (drives_forwards(this->actions[i]) != drives_forwards(this->actions[action_index]))
+                return 0.0;
+            return this->actions[i].exit_velocity;
+        }
+    }
+    return 0.0;
+}
+
+// size of the blocks the text format is read in, also the longest a token can be
+#define ROUTE_READ_BLOCK 8192
+
+namespace {
+    // splits a stream into whitespace separated tokens without copying them out of the read buffer
+    class RouteTokenizer {
+        private:
+            std::istream &stream;
+            std::vector<char> buffer;
+            size_t start = 0; // start of the unread part of the buffer
+            size_t end = 0; // end of the data in the buffer
+
+            // move the unread part to the front of the buffer and read the next block after it, false if nothing was read
+            bool fill() {
+                if (start > 0) {
+                    memmove(this->buffer.data(), this->buffer.data() + this->start, this->end - this->start);
+                    this->end -= this->start;
+                    this->start = 0;
+                }
+
+                if (this->end == this->buffer.size() || !this->stream)
+                    return false;
+
+                this->stream.read(this->buffer.data() + this->end, this->buffer.size() - this->end);
+                size_t read_size = this->stream.gcount();
+                this->end += read_size;
+                return read_size > 0;
+            }
+
+            static bool is_space(char c) {
+                return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+            }
+        public:
+            RouteTokenizer(std::istream &stream) : stream(stream), buffer(ROUTE_READ_BLOCK) {}
+
+            // next token, empty at the end of the stream. Only valid until the next call
+            std::string_view next() {
+                while (true) {
+                    while (this->start < this->end && is_space(this->buffer[this->start]))
+                        this->start++;
+                    if (this->start < this->end)
+                        break;
+                    if (!this->fill())
+                        return std::string_view();
+                }
+
+                size_t i = this->start;
+                while (true) {
+                    while (i < this->end && !is_space(this->buffer[i]))
+                        i++;
+                    if (i < this->end)
+                        break;
+
+                    // token runs into the end of the buffer, read more behind it
+                    size_t token_length = i - this->start;
+                    bool filled = this->fill();
+                    i = this->start + token_length;
+                    if (!filled)
+                        break;
+                }
+
+                std::string_view token(this->buffer.data() + this->start, i - this->start);
+                this->start = i;
+                return token;
+            }
+
+            // next token as a number, 0 if it isn't one
+            float next_float() {
+                std::string_view token = this->next();
+                float value = 0.0;
+                std::from_chars(token.data(), token.data() + token.size(), value);
+                return value;
+            }
+    };
+}
+
+knights::AdvancedRoute knights::parse_advanced_route(std::istream &stream) {
+    knights::AdvancedRoute route;
+    RouteTokenizer tokenizer(stream);
+
+    std::string_view token;
+    while (!(token = tokenizer.next()).empty()) {
+        if (token == "rs") { // follow route
+            float end_tol = tokenizer.next_float();
+            int timeout = tokenizer.next_float();
+            float lookahead = tokenizer.next_float();
+
+            std::vector<knights::Pos> positions;
+            std::vector<knights::RouteMarker> markers;
+            while (!(token = tokenizer.next()).empty() && token != "re") {
+                if (token == "p") {
+                    float x = tokenizer.next_float();
+                    float y = tokenizer.next_float();
+                    positions.emplace_back(x, y, 0);
+                }
+                else if (token == "m") { // marker, "m 30 name" is 30 inches along the route and "m 95% name" is 95% of the way
+                    token = tokenizer.next();
+                    float position = 0.0;
+                    std::from_chars(token.data(), token.data() + token.size(), position);
+                    bool fraction = !token.empty() && token.back() == '%';
+
+                    token = tokenizer.next();
+                    markers.emplace_back(fraction ? position / 100 : position, fraction, std::string(token));
+                }
+            }
+
+            route.actions.emplace_back(knights::action_type::FOLLOW, (int)route.routes.size(), end_tol, timeout, lookahead);
+            route.routes.emplace_back(std::move(positions));
+            route.routes.back().markers = std::move(markers);
+        }
+        else if (token == "ps" || token == "ts") { // move for distance or turn to angle
+            // distance or angle, end tolerance, timeout
+            knights::action_type type = token == "ps" ? knights::action_type::LATERAL : knights::action_type::TURN;
+            float specific = tokenizer.next_float();
+            float end_tol = tokenizer.next_float();
+            int timeout = tokenizer.next_float();
+            route.actions.emplace_back(type, specific, end_tol, timeout);
+        }
+        else if (token == "cs") { // command start
+            token = tokenizer.next();
+            route.actions.emplace_back(knights::action_type::COMMAND, std::string(token));
+        }
+        else if ((token == "ch" || token == "st" || token == "wt") && !route.actions.empty()) { // when the next action starts
+            // ch = chain into the next action with an exit velocity, st = wait to settle under a velocity, wt = wait a time
+            knights::RouteAction &action = route.actions.back();
+            float value = tokenizer.next_float();
+            if (token == "ch") {
+                action.next_start = knights::start_condition::IMMEDIATE;
+                action.exit_velocity = value;
+            }
+            else {
+                action.next_start = token == "st" ? knights::start_condition::SETTLED : knights::start_condition::AFTER_DELAY;
+                action.next_value = value;
+            }
+        }
+        else if (token == "eof")
+            break;
+    }
+
+    return route;
+}
+
+// compiled route format, version 5. Everything is little endian (same as the brain) and 4 byte aligned, and
+// offsets are from the start of the file so the loader can read the whole file at once and copy straight out of it.
+//   header:       CompiledHeader
+//   action table: CompiledAction for each action
+//   route table:  CompiledRoute for each follow route, in route index order
+//   data:         packed float arrays for the positions, geometry cache, trajectories and markers of each route, then the strings
+#define COMPILED_ROUTE_VERSION 5
+
+namespace {
+    struct CompiledHeader {
+        char magic[4]; // "KLRC"
+        uint32_t version;
+        uint32_t checksum; // FNV-1a of everything after the header
+        uint32_t file_size;
+        uint32_t action_amt;
+        uint32_t route_amt;
+    };
+
+    struct CompiledAction {
+        uint32_t type;
+        float specific;
+        float end_tolerance;
+        int32_t timeout;
+        float lookahead;
+        int32_t route_index; // follows only
+        uint32_t next_start;
+        float next_value;
+        float exit_velocity;
+        uint32_t name_offset; // function name for commands
+        uint32_t name_length;
+    };
+
+    struct CompiledRoute {
+        uint32_t position_amt;
+        uint32_t positions_offset; // position_amt (x, y, heading)
+        uint32_t arc_lengths_offset; // position_amt floats
+        uint32_t curvatures_offset; // position_amt floats
+        uint32_t segment_lengths_offset; // position_amt - 1 floats
+        uint32_t segment_directions_offset; // position_amt - 1 (x, y)
+        uint32_t timestamp_amt;
+        uint32_t timestamps_offset; // timestamp_amt ProfileTimestamps
+        uint32_t marker_amt;
+        uint32_t markers_offset; // marker_amt CompiledMarkers
+    };
+
+    struct CompiledMarker {
+        float position;
+        uint32_t fraction;
+        uint32_t name_offset;
+        uint32_t name_length;
+    };
+
+    // the arrays are copied straight in and out of these types, so their layout has to stay packed floats
+    static_assert(sizeof(knights::Pos) == 3 * sizeof(float), "Pos must be three packed floats");
+    static_assert(sizeof(knights::Point) == 2 * sizeof(float), "Point must be two packed floats");
+    static_assert(sizeof(knights::ProfileTimestamp) == 9 * sizeof(float), "ProfileTimestamp must be nine packed floats");
+
+    uint32_t fnv1a(const char *data, size_t size) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= (uint8_t)data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    // append an array to the buffer and return its offset
+    uint32_t append(std::vector<char> &buffer, const void *data, size_t size) {
+        uint32_t offset = buffer.size();
+        buffer.resize(buffer.size() + ((size + 3) & ~3), 0); // keep everything 4 byte aligned
+        if (size > 0)
+            memcpy(buffer.data() + offset, data, size);
+        return offset;
+    }
+
+    // copy an array out of the buffer, false if it would read past the end
+    template <typename T>
+    bool copy_out(const char *data, size_t size, uint32_t offset, uint32_t amt, std::vector<T> &out) {
+        if ((size_t)offset + (size_t)amt * sizeof(T) > size)
+            return false;
+        out.resize(amt);
+        if (amt > 0)
+            memcpy((void*)out.data(), data + offset, amt * sizeof(T));
+        return true;
+    }
+}
+
+bool knights::write_compiled_route(std::ostream &stream, const knights::AdvancedRoute &route) {
+    const std::vector<knights::RouteAction> &actions = route.actions;
+    std::vector<CompiledAction> action_table(route.actions.size());
+    std::vector<CompiledRoute> route_table(route.routes.size());
+
+    // space for the header and tables is filled in at the end, once the data offsets are known
+    std::vector<char> buffer(sizeof(CompiledHeader) + action_table.size() * sizeof(CompiledAction) + route_table.size() * sizeof(CompiledRoute), 0);
+
+    for (int i = 0; i < route.routes.size(); i++) {
+        knights::Route cached = route.routes[i];
+        if (!cached.geometry_valid())
+            cached.compute_geometry();
+
+        CompiledRoute &entry = route_table[i];
+        entry.position_amt = cached.positions.size();
+        entry.positions_offset = append(buffer, cached.positions.data(), cached.positions.size() * sizeof(knights::Pos));
+        entry.arc_lengths_offset = append(buffer, cached.arc_lengths.data(), cached.arc_lengths.size() * sizeof(float));
+        entry.curvatures_offset = append(buffer, cached.curvatures.data(), cached.curvatures.size() * sizeof(float));
+        entry.segment_lengths_offset = append(buffer, cached.segment_lengths.data(), cached.segment_lengths.size() * sizeof(float));
+        entry.segment_directions_offset = append(buffer, cached.segment_directions.data(), cached.segment_directions.size() * sizeof(knights::Point));
+
+        if (i < route.profiles.size()) {
+            const std::vector<knights::ProfileTimestamp> &profile = route.profiles[i];
+            entry.timestamp_amt = profile.size();
+            entry.timestamps_offset = append(buffer, profile.data(), profile.size() * sizeof(knights::ProfileTimestamp));
+        }
+
+        // marker records first so they stay together, then their names
+        std::vector<CompiledMarker> markers(cached.markers.size());
+        entry.marker_amt = markers.size();
+        entry.markers_offset = append(buffer, markers.data(), markers.size() * sizeof(CompiledMarker));
+        for (int j = 0; j < markers.size(); j++) {
+            const knights::RouteMarker &marker = cached.markers[j];
+            markers[j] = {marker.position, marker.fraction, 0, (uint32_t)marker.function_name.size()};
+            markers[j].name_offset = append(buffer, marker.function_name.data(), marker.function_name.size());
+        }
+        if (!markers.empty())
+            memcpy(buffer.data() + entry.markers_offset, markers.data(), markers.size() * sizeof(CompiledMarker));
+    }
+
+    for (int j = 0; j < actions.size(); j++) {
+        const knights::RouteAction &action = actions[j];
+        const std::string &name = action.function_name;
+
+        action_table[j] = {(uint32_t)action.type, action.specific, action.end_tolerance, action.timeout, action.lookahead, 
+            action.route_index, (uint32_t)action.next_start, action.next_value, action.exit_velocity, 0, (uint32_t)name.size()};
+        action_table[j].name_offset = append(buffer, name.data(), name.size());
+    }
+
+    CompiledHeader header = {{'K', 'L', 'R', 'C'}, COMPILED_ROUTE_VERSION, 0, (uint32_t)buffer.size(), 
+        (uint32_t)action_table.size(), (uint32_t)route_table.size()};
+
+    char *table = buffer.data() + sizeof(CompiledHeader);
+    if (!action_table.empty())
+        memcpy(table, action_table.data(), action_table.size() * sizeof(CompiledAction));
+    if (!route_table.empty())
+        memcpy(table + action_table.size() * sizeof(CompiledAction), route_table.data(), route_table.size() * sizeof(CompiledRoute));
+
+    header.checksum = fnv1a(buffer.data() + sizeof(CompiledHeader), buffer.size() - sizeof(CompiledHeader));
+    memcpy(buffer.data(), &header, sizeof(CompiledHeader));
+
+    stream.write(buffer.data(), buffer.size());
+    return (bool)stream;
+}
+
+knights::AdvancedRoute knights::read_compiled_route(const char *data, size_t size) {
+    CompiledHeader header;
+
+    // check this is a compiled route of this version that hasn't been cut off or corrupted
+    if (size < sizeof(CompiledHeader))
+        return knights::AdvancedRoute();
+    memcpy(&header, data, sizeof(CompiledHeader));
+
+    size_t tables_size = (size_t)header.action_amt * sizeof(CompiledAction) + (size_t)header.route_amt * sizeof(CompiledRoute);
+    if (memcmp(header.magic, "KLRC", 4) != 0 || header.version != COMPILED_ROUTE_VERSION || header.file_size != size 
+        || sizeof(CompiledHeader) + tables_size > size
+        || header.checksum != fnv1a(data + sizeof(CompiledHeader), size - sizeof(CompiledHeader)))
+        return knights::AdvancedRoute();
+
+    knights::AdvancedRoute route;
+    const char *table = data + sizeof(CompiledHeader);
+
+    route.actions.reserve(header.action_amt);
+    for (uint32_t i = 0; i < header.action_amt; i++) {
+        CompiledAction action;
+        memcpy(&action, table + i * sizeof(CompiledAction), sizeof(CompiledAction));
+
+        if ((size_t)action.name_offset + action.name_length > size)
+            return knights::AdvancedRoute();
+        std::string name(data + action.name_offset, action.name_length);
+
+        if (action.type == knights::action_type::COMMAND)
+            route.actions.emplace_back(knights::action_type::COMMAND, name);
+        else if (action.type == knights::action_type::FOLLOW) {
+            if (action.route_index < 0 || action.route_index >= (int64_t)header.route_amt)
+                return knights::AdvancedRoute();
+            route.actions.emplace_back(knights::action_type::FOLLOW, action.route_index, action.end_tolerance, action.timeout, action.lookahead);
+        }
+        else
+            route.actions.emplace_back((knights::action_type)action.type, action.specific, action.end_tolerance, action.timeout);
+
+        route.actions.back().next_start = (knights::start_condition)action.next_start;
+        route.actions.back().next_value = action.next_value;
+        route.actions.back().exit_velocity = action.exit_velocity;
+    }
+
+    table += header.action_amt * sizeof(CompiledAction);
+    route.routes.resize(header.route_amt);
+    route.profiles.resize(header.route_amt);
+    for (uint32_t i = 0; i < header.route_amt; i++) {
+        CompiledRoute entry;
+        memcpy(&entry, table + i * sizeof(CompiledRoute), sizeof(CompiledRoute));
+
+        // the geometry cache is stored in the file, so the route is copied out without computing anything
+        uint32_t segment_amt = entry.position_amt > 0 ? entry.position_amt - 1 : 0;
+        knights::Route &curr_route = route.routes[i];
+        if (!copy_out(data, size, entry.positions_offset, entry.position_amt, curr_route.positions)
+            || !copy_out(data, size, entry.arc_lengths_offset, entry.position_amt, curr_route.arc_lengths)
+            || !copy_out(data, size, entry.curvatures_offset, entry.position_amt, curr_route.curvatures)
+            || !copy_out(data, size, entry.segment_lengths_offset, segment_amt, curr_route.segment_lengths)
+            || !copy_out(data, size, entry.segment_directions_offset, segment_amt, curr_route.segment_directions))
+            return knights::AdvancedRoute();
+
+        if (entry.timestamp_amt > 0 && !copy_out(data, size, entry.timestamps_offset, entry.timestamp_amt, route.profiles[i]))
+            return knights::AdvancedRoute();
+
+        if ((size_t)entry.markers_offset + (size_t)entry.marker_amt * sizeof(CompiledMarker) > size)
+            return knights::AdvancedRoute();
+        curr_route.markers.reserve(entry.marker_amt);
+        for (uint32_t j = 0; j < entry.marker_amt; j++) {
+            CompiledMarker marker;
+            memcpy(&marker, data + entry.markers_offset + j * sizeof(CompiledMarker), sizeof(CompiledMarker));
+            if ((size_t)marker.name_offset + marker.name_length > size)
+                return knights::AdvancedRoute();
+            curr_route.markers.emplace_back(marker.position, marker.fraction, std::string(data + marker.name_offset, marker.name_length));
+        }
+    }
+
+    return route;
+}
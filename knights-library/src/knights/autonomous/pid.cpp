@@ -0,0 +1,105 @@
+#include "knights/autonomous/pid.h"
+
+#include "knights/util/calculation.h"
+
+#include <algorithm>
+#include <cmath>
+
+knights::PIDGains::PIDGains(float min_error, float kP, float kI, float kD)
+    : min_error(min_error), kP(kP), kI(kI), kD(kD) {
+}
+
+knights::PIDController::PIDController(float kP, float kI, float kD)
+    : kP(kP), kI(kI), kD(kD), min_velocity(0.0), max_velocity(127.0) {
+}
+
+knights::PIDController::PIDController(float kP, float kI, float kD, float min_velocity, float max_velocity)
+    : kP(kP), kI(kI), kD(kD), min_velocity(min_velocity), max_velocity(max_velocity) {
+}
+
+knights::PIDController::PIDController()
+    : kP(0.0), kI(0.0), kD(0.0), min_velocity(0.0), max_velocity(127.0) {
+}
+
+float knights::PIDController::update(float error, float total_error, float prev_error) {
+    return knights::clamp(this->kP * error + this->kI * total_error + this->kD * (error - prev_error), this->min_velocity, this->max_velocity);
+}
+
+float knights::PIDController::calculate(float target, float measurement, float dt, bool use_min_velocity) {
+    float error = target - measurement;
+
+    // the first loop of a movement has no time since the last one, use the usual loop period
+    if (dt <= 0)
+        dt = PID_LOOP_PERIOD;
+
+    // how many usual loop periods passed, so the integral and derivative scale with the actual time
+    float periods = dt / PID_LOOP_PERIOD;
+
+    // pick the tuner values for the size of the error, the schedule is sorted so the last match is the largest
+    float p = this->kP, i = this->kI, d = this->kD;
+    for (const knights::PIDGains &gains : this->schedule) {
+        if (std::fabs(error) < gains.min_error)
+            break;
+        p = gains.kP; i = gains.kI; d = gains.kD;
+    }
+
+    // integral, cleared once the target is crossed so it doesn't keep pushing past it
+    if (this->has_prev && this->reset_integral_on_cross && ((error > 0 && this->prev_error < 0) || (error < 0 && this->prev_error > 0)))
+        this->integral = 0.0;
+    this->integral += error * periods;
+
+    // limit the integral so it can't wind up while the system is saturated
+    float limit = (this->integral_limit < 0) ? this->max_velocity : this->integral_limit;
+    if (i != 0)
+        this->integral = knights::clamp(this->integral, -limit / std::fabs(i), limit / std::fabs(i));
+
+    // derivative on the measurement, same as the derivative of the error when the target doesn't move
+    if (this->has_prev) {
+        float raw_derivative = -(measurement - this->prev_measurement) / periods;
+        this->derivative = this->derivative_filter * this->derivative + (1 - this->derivative_filter) * raw_derivative;
+    } else
+        this->derivative = 0.0;
+
+    this->prev_error = error;
+    this->prev_measurement = measurement;
+    this->has_prev = true;
+
+    // keep the sign so the system is pushed back after going past the target, only the size is clamped
+    float output = p * error + i * this->integral + d * this->derivative;
+    float min_velocity = use_min_velocity ? this->min_velocity : 0.0f;
+    return knights::signum(output) * knights::clamp(std::fabs(output), min_velocity, this->max_velocity);
+}
+
+void knights::PIDController::reset() {
+    this->integral = 0.0;
+    this->prev_error = 0.0;
+    this->prev_measurement = 0.0;
+    this->derivative = 0.0;
+    this->has_prev = false;
+}
+
+void knights::PIDController::set_integral_limit(float limit) {
+    this->integral_limit = limit;
+}
+
+void knights::PIDController::set_integral_reset(bool reset) {
+    this->reset_integral_on_cross = reset;
+}
+
+void knights::PIDController::set_derivative_filter(float alpha) {
+    this->derivative_filter = knights::clamp(alpha, 0.0f, 0.99f);
+}
+
+void knights::PIDController::add_gain_schedule(float min_error, float kP, float kI, float kD) {
+    this->schedule.emplace_back(min_error, kP, kI, kD);
+    std::sort(this->schedule.begin(), this->schedule.end(),
+        [](const knights::PIDGains &a, const knights::PIDGains &b) { return a.min_error < b.min_error; });
+}
+
+float knights::PIDController::get_max_speed() {
+    return std::fabs(this->max_velocity);
+}
+
+float knights::PIDController::get_min_speed() {
+    return std::fabs(this->min_velocity);
+}
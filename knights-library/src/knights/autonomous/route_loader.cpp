@@ -0,0 +1,95 @@
+#include "knights/autonomous/path.h"
+#include "knights/logger/logger.h"
+#include "knights/util/position.h"
+
+#include "api.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+knights::Route knights::init_route_from_sd(std::string route_name) {
+
+    if (pros::usd::is_installed()) {
+        route_name.insert(0, "/usd/");
+
+        std::fstream read_file(route_name, std::ios_base::in);
+
+        if (read_file) {
+            std::vector<knights::Pos> positions;
+
+            float x,y;
+
+            while (read_file >> x && read_file >> y) {
+                positions.emplace_back(x,y,0);
+            }
+
+            return knights::Route(positions);
+
+        } else {
+            return knights::Route();
+        }
+    } else {
+        printf("SD card not found\n");
+        return knights::Route();
+    }
+}
+
+knights::AdvancedRoute advanced_route_from_file(std::string file_name) {
+    if (pros::usd::is_installed()) {
+        printf("Found SD card\n");
+        file_name.insert(0, "/usd/");
+
+        std::fstream read_file(file_name, std::ios_base::in);
+
+        if (read_file) {
+            knights::AdvancedRoute route = knights::parse_advanced_route(read_file);
+            knights::logger::red(knights::logger::string_format("loaded %s: %d actions, %d routes", 
+                file_name.c_str(), (int)route.actions.size(), (int)route.routes.size()));
+            return route;
+        } else {
+            return knights::AdvancedRoute();
+        }
+    } else {
+        printf("SD card not found\n");
+        return knights::AdvancedRoute();
+    }
+}
+
+knights::AdvancedRoute compiled_route_from_file(std::string file_name) {
+    if (pros::usd::is_installed()) {
+        file_name.insert(0, "/usd/");
+
+        FILE *read_file = fopen(file_name.c_str(), "rb");
+
+        if (read_file) {
+            // read the whole file with one read, the route is then copied straight out of the buffer
+            fseek(read_file, 0, SEEK_END);
+            long size = ftell(read_file);
+            fseek(read_file, 0, SEEK_SET);
+
+            std::vector<char> buffer(size > 0 ? size : 0);
+            size_t read_size = fread(buffer.data(), 1, buffer.size(), read_file);
+            fclose(read_file);
+
+            knights::AdvancedRoute route = knights::read_compiled_route(buffer.data(), read_size);
+            if (route.actions.empty())
+                knights::logger::red(knights::logger::string_format("%s is not a valid compiled route", file_name.c_str()));
+            else {
+                int trajectory_amt = 0;
+                for (const std::vector<knights::ProfileTimestamp> &profile : route.profiles)
+                    trajectory_amt += !profile.empty();
+
+                knights::logger::red(knights::logger::string_format("loaded %s: %d actions, %d routes, %d trajectories", 
+                    file_name.c_str(), (int)route.actions.size(), (int)route.routes.size(), trajectory_amt));
+            }
+            return route;
+        } else {
+            return knights::AdvancedRoute();
+        }
+    } else {
+        printf("SD card not found\n");
+        return knights::AdvancedRoute();
+    }
+}
@@ -3,6 +3,9 @@
 #include "api.h"
 #include "display.h"
 
+#include <atomic>
+#include <cstdio>
+
 #define TILE 180/6
 #define X_MARGIN 270
 #define Y_MARGIN 40
@@ -133,4 +136,51 @@ void lv_display(void) {
 
 void knights::display::set_pos_label(std::string str) {
     lv_label_set_text(pos_label, str.c_str());
-}
\ No newline at end of file
+}
+
+static pros::Task *position_display_task = nullptr;
+static std::atomic<bool> position_display_running = false; // cleared to ask the task to stop
+static std::atomic<bool> position_display_stopped = true; // set by the task once it has stopped
+
+void knights::display::start_position_display(knights::RobotChassis *chassis, std::uint32_t period) {
+    if (position_display_task != nullptr)
+        return;
+
+    position_display_running = true;
+    position_display_stopped = false;
+
+    position_display_task = new pros::Task([chassis, period]() {
+        std::uint32_t shown_generation = 0;
+        char label[64];
+
+        std::uint32_t wake_time = pros::millis();
+        while (position_display_running) {
+            // only redraw once a new position has been published
+            knights::PoseSample sample;
+            std::uint32_t generation = chassis->get_snapshot(sample);
+            if (generation != shown_generation) {
+                snprintf(label, sizeof(label), "Curr Pos: %.2f %.2f %.2f", sample.pose.x, sample.pose.y, knights::to_deg(sample.pose.heading));
+                lv_label_set_text(pos_label, label);
+                curr_position_dot.set_field_pos(sample.pose);
+
+                shown_generation = generation;
+            }
+
+            pros::Task::delay_until(&wake_time, (period > 0) ? period : 1);
+        }
+
+        position_display_stopped = true;
+    }, DISPLAY_PRIORITY, TASK_STACK_DEPTH_DEFAULT, "knights display");
+}
+
+void knights::display::stop_position_display() {
+    if (position_display_task == nullptr)
+        return;
+
+    position_display_running = false;
+    while (!position_display_stopped)
+        pros::delay(1);
+
+    delete position_display_task;
+    position_display_task = nullptr;
+}
@@ -0,0 +1,77 @@
+#include "knights/robot/drivetrain.h"
+#include "knights/logger/logger.h"
+#include "knights/util/timer.h"
+
+#include "api.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// time to let the robot stop between tests, in milliseconds
+#define CHARACTERIZE_REST_TIME 1500
+
+namespace {
+    struct CharacterizeSample {
+        int test; // index of the test in test_names
+        float time; // time since the test started, in milliseconds
+        float right_voltage, left_voltage; // voltage sent to each side, in volts
+        float right_velocity, left_velocity; // measured velocity of each side, in inches per second
+    };
+
+    const char *test_names[] = {"quasistatic-forward", "quasistatic-backward", "dynamic-forward", "dynamic-backward"};
+}
+
+void knights::Drivetrain::characterize(std::string file_name, float ramp_rate, float step_voltage, float quasistatic_time, float dynamic_time) {
+    this->right_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_COAST);
+    this->left_mtrs->set_brake_mode_all(pros::E_MOTOR_BRAKE_COAST);
+
+    // samples are kept in memory during the tests and written after, so writing to the SD card doesn't slow the loop down
+    std::vector<CharacterizeSample> samples;
+    samples.reserve(2 * ((quasistatic_time + dynamic_time) / 10 + 1));
+
+    for (int test = 0; test < 4; test++) {
+        bool quasistatic = test < 2;
+        float direction = (test % 2 == 0) ? 1.0 : -1.0;
+        float test_time = quasistatic ? quasistatic_time : dynamic_time;
+
+        knights::logger::yellow(knights::logger::string_format("characterization: %s", test_names[test]));
+
+        knights::Timer timer;
+        while (timer.get() < test_time) {
+            float time = timer.get();
+
+            // quasistatic slowly ramps the voltage so acceleration is negligible, dynamic steps it to see the acceleration
+            float voltage = direction * (quasistatic ? ramp_rate * time / 1000 : step_voltage);
+            this->voltage_command(voltage, voltage);
+
+            samples.push_back({test, time, voltage, voltage, this->right_velocity(), this->left_velocity()});
+
+            pros::delay(10);
+        }
+
+        this->voltage_command(0, 0);
+        pros::delay(CHARACTERIZE_REST_TIME);
+    }
+
+    if (!pros::usd::is_installed()) {
+        printf("SD card not found\n");
+        return;
+    }
+
+    file_name.insert(0, "/usd/");
+    FILE *write_file = fopen(file_name.c_str(), "w");
+    if (write_file == nullptr) {
+        printf("couldn't open %s\n", file_name.c_str());
+        return;
+    }
+
+    fprintf(write_file, "test,time,right_voltage,left_voltage,right_velocity,left_velocity\n");
+    for (const CharacterizeSample &sample : samples) {
+        fprintf(write_file, "%s,%.0f,%.4f,%.4f,%.4f,%.4f\n", test_names[sample.test], sample.time,
+            sample.right_voltage, sample.left_voltage, sample.right_velocity, sample.left_velocity);
+    }
+    fclose(write_file);
+
+    knights::logger::green(knights::logger::string_format("characterization: wrote %d samples to %s", (int)samples.size(), file_name.c_str()));
+}
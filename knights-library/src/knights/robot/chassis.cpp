@@ -14,31 +14,324 @@ knights::RobotChassis::RobotChassis(Holonomic *drivetrain, PositionTrackerGroup
     : holonomic(drivetrain), pos_trackers(pos_trackers) {
 }
 
+knights::RobotChassis::RobotChassis(Drivetrain *drivetrain, OdometrySource *odometry)
+    : drivetrain(drivetrain), odometry(odometry) {
+}
+
+knights::RobotChassis::RobotChassis(Holonomic *drivetrain, OdometrySource *odometry)
+    : holonomic(drivetrain), odometry(odometry) {
+}
+
 void knights::RobotChassis::set_position(float x, float y, float heading) {
+    this->position_mutex.take(TIMEOUT_MAX);
     this->curr_position.x = x;
     this->curr_position.y = y;
     this->curr_position.heading = heading;
+    this->estimator_reset = true;
+    this->localizer_reset = true;
+
+    // poses from before were measured from a different position, so they can't be interpolated with the new ones
+    this->pose_history.clear();
+    this->publish_position(false, pros::millis());
+    this->position_mutex.give();
 }
 
 knights::Pos knights::RobotChassis::get_position() {
-    return this->curr_position;
+    ChassisState state;
+    this->position_state.read(state);
+    return state.sample.pose;
 }
 
 void knights::RobotChassis::set_position(knights::Pos position) {
+    this->position_mutex.take(TIMEOUT_MAX);
     this->curr_position = position;
-    this->set_prev_position(position);
+    this->prev_position = position;
+    this->estimator_reset = true;
+    this->localizer_reset = true;
+
+    this->pose_history.clear();
+    this->publish_position(false, pros::millis());
+    this->position_mutex.give();
 };
 
 void knights::RobotChassis::set_prev_position(float x, float y, float heading) {
-    this->prev_position.x = x;
-    this->prev_position.y = y;
-    this->prev_position.heading = heading;
+    this->set_prev_position(Pos(x, y, heading));
 }
 
 knights::Pos knights::RobotChassis::get_prev_position() {
-    return this->prev_position;
+    ChassisState state;
+    this->position_state.read(state);
+    return state.prev_position;
 }
 
 void knights::RobotChassis::set_prev_position(knights::Pos position) {
+    this->position_mutex.take(TIMEOUT_MAX);
     this->prev_position = position;
-};
\ No newline at end of file
+    this->publish_position(false, pros::millis());
+    this->position_mutex.give();
+};
+
+std::uint32_t knights::RobotChassis::get_snapshot(knights::PoseSample &sample) {
+    ChassisState state;
+    std::uint32_t generation = this->position_state.read(state);
+    sample = state.sample;
+    return generation;
+}
+
+std::uint32_t knights::RobotChassis::get_positions(knights::Pos &position, knights::Pos &prev_position) {
+    ChassisState state;
+    std::uint32_t generation = this->position_state.read(state);
+    position = state.sample.pose;
+    prev_position = state.prev_position;
+    return generation;
+}
+
+std::uint32_t knights::RobotChassis::get_generation() {
+    return this->position_state.generation();
+}
+
+void knights::RobotChassis::read_sensors(knights::SensorFrame &frame) {
+    frame = SensorFrame();
+    frame.time = pros::millis();
+
+    // the compiled odometry reads its own sensors
+    if (this->pos_trackers != nullptr && this->odometry == nullptr) {
+        if (this->pos_trackers->right_tracker != nullptr)
+            frame.right = this->pos_trackers->right_tracker->get_distance_travelled();
+        if (this->pos_trackers->left_tracker != nullptr)
+            frame.left = this->pos_trackers->left_tracker->get_distance_travelled();
+        if (this->pos_trackers->front_tracker != nullptr)
+            frame.front = this->pos_trackers->front_tracker->get_distance_travelled();
+        if (this->pos_trackers->back_tracker != nullptr)
+            frame.back = this->pos_trackers->back_tracker->get_distance_travelled();
+        if (this->pos_trackers->inertial != nullptr) {
+            frame.imu_heading = this->pos_trackers->inertial->get_heading();
+            frame.imu_rate = this->pos_trackers->inertial->get_gyro_rate().z;
+        }
+    }
+
+    if (this->drivetrain != nullptr) {
+        frame.right_velocity = this->drivetrain->right_velocity();
+        frame.left_velocity = this->drivetrain->left_velocity();
+        frame.drive_velocity = ChassisSpeeds((frame.right_velocity + frame.left_velocity) / 2, 0,
+            (frame.right_velocity - frame.left_velocity) / this->drivetrain->track_width);
+    } else if (this->holonomic != nullptr)
+        frame.drive_velocity = this->holonomic->get_velocity();
+}
+
+std::uint32_t knights::RobotChassis::get_sensor_frame(knights::SensorFrame &frame) {
+    return this->sensor_state.read(frame);
+}
+
+knights::ChassisSpeeds knights::RobotChassis::get_measured_velocity() {
+    SensorFrame frame;
+    this->sensor_state.read(frame);
+    if (this->sensor_state.generation() > 0 && pros::millis() - frame.time <= SENSOR_FRAME_STALE_TIME)
+        return frame.drive_velocity;
+
+    // nothing is reading the sensors, so read the motors here
+    if (this->drivetrain != nullptr) {
+        float right = this->drivetrain->right_velocity(), left = this->drivetrain->left_velocity();
+        return ChassisSpeeds((right + left) / 2, 0, (right - left) / this->drivetrain->track_width);
+    }
+    if (this->holonomic != nullptr)
+        return this->holonomic->get_velocity();
+    return ChassisSpeeds();
+}
+
+void knights::RobotChassis::set_estimator(knights::PoseEKF *estimator) {
+    this->position_mutex.take(TIMEOUT_MAX);
+    this->estimator = estimator;
+    this->estimator_reset = true;
+    this->publish_position(false, pros::millis());
+    this->position_mutex.give();
+}
+
+bool knights::RobotChassis::get_covariance(float covariance[3][3]) {
+    ChassisState state;
+    this->position_state.read(state);
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            covariance[r][c] = state.covariance[r][c];
+    return this->estimator != nullptr;
+}
+
+void knights::RobotChassis::publish_position(bool moved, std::uint32_t time) {
+    ChassisState last;
+    this->position_state.read(last);
+
+    ChassisState state;
+    state.sample.pose = this->curr_position;
+    state.sample.time = time;
+    state.prev_position = this->prev_position;
+    if (this->estimator != nullptr)
+        this->estimator->get_covariance(state.covariance);
+    else
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                state.covariance[r][c] = 0;
+
+    // velocity from the change since the last published position, kept if no time has passed
+    if (moved && this->position_state.generation() > 0) {
+        if (state.sample.time > last.sample.time) {
+            float dt = (state.sample.time - last.sample.time) / 1000.0;
+            state.sample.velocity_x = (state.sample.pose.x - last.sample.pose.x) / dt;
+            state.sample.velocity_y = (state.sample.pose.y - last.sample.pose.y) / dt;
+            state.sample.angular_velocity = knights::min_angle(last.sample.pose.heading, state.sample.pose.heading, true) / dt;
+        } else {
+            state.sample.velocity_x = last.sample.velocity_x;
+            state.sample.velocity_y = last.sample.velocity_y;
+            state.sample.angular_velocity = last.sample.angular_velocity;
+        }
+    }
+
+    this->position_state.write(state);
+    this->pose_history.push(state.sample);
+}
+
+void knights::RobotChassis::start_odometry(std::uint32_t period) {
+    if (this->odometry_task != nullptr)
+        return;
+
+    this->odometry_period = (period > 0) ? period : 1;
+    this->odometry_overruns = 0;
+
+    this->position_mutex.take(TIMEOUT_MAX);
+    this->pose_history.clear();
+    this->position_mutex.give();
+    this->odometry_running = true;
+    this->odometry_stopped = false;
+
+    this->odometry_task = new pros::Task([this]() { this->odometry_loop(); }, ODOMETRY_PRIORITY, TASK_STACK_DEPTH_DEFAULT, "knights odometry");
+}
+
+void knights::RobotChassis::stop_odometry() {
+    if (this->odometry_task == nullptr)
+        return;
+
+    this->odometry_running = false;
+    while (!this->odometry_stopped)
+        pros::delay(1);
+
+    delete this->odometry_task;
+    this->odometry_task = nullptr;
+}
+
+void knights::RobotChassis::odometry_loop() {
+    // woken up at fixed times, so the period doesn't drift with how long the update takes
+    std::uint32_t wake_time = pros::millis();
+
+    while (this->odometry_running) {
+        // publishes the new position and adds it to the pose history
+        this->update_position();
+
+        if (pros::millis() - wake_time >= this->odometry_period)
+            this->odometry_overruns++;
+
+        pros::Task::delay_until(&wake_time, this->odometry_period);
+    }
+
+    this->odometry_stopped = true;
+}
+
+void knights::RobotChassis::start_localization(knights::MonteCarloLocalizer *localizer, std::vector<pros::Distance*> sensors,
+    std::uint32_t period) {
+    if (this->localization_task != nullptr || localizer == nullptr)
+        return;
+
+    this->localizer = localizer;
+    this->distance_sensors = sensors;
+    this->localization_period = (period > 0) ? period : 1;
+    this->localizer_reset = false;
+    this->localizer->initialize(this->get_position());
+
+    this->localization_running = true;
+    this->localization_stopped = false;
+
+    this->localization_task = new pros::Task([this]() { this->localization_loop(); }, LOCALIZATION_PRIORITY, TASK_STACK_DEPTH_DEFAULT,
+        "knights localization");
+}
+
+void knights::RobotChassis::stop_localization() {
+    if (this->localization_task == nullptr)
+        return;
+
+    this->localization_running = false;
+    while (!this->localization_stopped)
+        pros::delay(1);
+
+    delete this->localization_task;
+    this->localization_task = nullptr;
+}
+
+void knights::RobotChassis::localization_loop() {
+    std::uint32_t wake_time = pros::millis();
+    std::vector<float> readings(this->distance_sensors.size());
+    Pos previous = this->get_position();
+
+    while (this->localization_running) {
+        pros::Task::delay_until(&wake_time, this->localization_period);
+
+        Pos current = this->get_position();
+        if (this->localizer_reset.exchange(false)) {
+            // the robot was placed somewhere else, moving the particles by the jump would leave them spread wrong
+            this->localizer->initialize(current);
+            previous = current;
+            continue;
+        }
+        this->localizer->predict(previous, current);
+        previous = current;
+
+        // millimeters to inches, the sensor reads 9999 when nothing is in range
+        for (int i = 0; i < (int)this->distance_sensors.size(); i++) {
+            std::int32_t distance = this->distance_sensors[i]->get_distance();
+            readings[i] = (distance == PROS_ERR || distance <= 0 || distance >= 9999) ? -1 : distance / 25.4;
+        }
+        if (this->localizer->update(readings.data()) == 0)
+            continue;
+
+        this->position_mutex.take(TIMEOUT_MAX);
+        // set_position was called since the particles were moved, the next update starts them over instead
+        if (this->localizer_reset) {
+            this->position_mutex.give();
+            continue;
+        }
+
+        Pos estimate = this->localizer->get_estimate();
+        bool corrected = false;
+        if (this->estimator != nullptr) {
+            if (!this->estimator_reset) {
+                float spread = this->localizer->get_spread();
+                this->estimator->update_position(estimate.x, estimate.y, spread * spread + LOCALIZATION_VARIANCE);
+                this->curr_position = this->estimator->get_pose();
+                corrected = true;
+            }
+        } else {
+            // nothing to weigh the particles against, so they replace the odometry's x and y
+            this->curr_position.x = estimate.x;
+            this->curr_position.y = estimate.y;
+            corrected = true;
+        }
+
+        if (corrected) {
+            this->publish_position(true, pros::millis());
+            // the particles move by the odometry from the corrected position, or they'd be moved by their own correction too
+            previous = this->curr_position;
+        }
+        this->position_mutex.give();
+    }
+
+    this->localization_stopped = true;
+}
+
+const knights::PoseHistory &knights::RobotChassis::get_pose_history() {
+    return this->pose_history;
+}
+
+bool knights::RobotChassis::get_pose_at(std::uint32_t time, knights::PoseSample &sample) {
+    return this->pose_history.at(time, sample);
+}
+
+std::uint32_t knights::RobotChassis::get_odometry_overruns() {
+    return this->odometry_overruns;
+}
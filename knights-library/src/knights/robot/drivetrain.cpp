@@ -1,16 +1,158 @@
 #include "pros/imu.hpp"
 #include <cmath>
 #include "knights/robot/drivetrain.h"
+#include "knights/autonomous/profile.h"
+#include "knights/util/calculation.h"
+
+// time without a command after which the output stage starts again from the measured velocity, in milliseconds
+#define OUTPUT_STALE_TIME 50
+// acceleration of gravity, in meters per second squared
+#define GRAVITY 9.81
 
 knights::Drivetrain::Drivetrain(pros::MotorGroup *right_mtrs, pros::MotorGroup *left_mtrs, float track_width, float rpm, float wheel_diameter, float gear_ratio) 
     : right_mtrs(right_mtrs), left_mtrs(left_mtrs), track_width(track_width), rpm(rpm), wheel_diameter(wheel_diameter), gear_ratio(gear_ratio) {
 }
 
 void knights::Drivetrain::velocity_command(int rightMtrs, int leftMtrs) {
+    if (this->output_max_acceleration > 0) {
+        // limit in physical units, then back to the motor command [-127, 127]
+        float scale = this->max_velocity() / 127.0;
+        float right_velocity = rightMtrs * scale, left_velocity = leftMtrs * scale;
+        this->limit_output(right_velocity, left_velocity);
+        rightMtrs = std::round(right_velocity / scale);
+        leftMtrs = std::round(left_velocity / scale);
+    }
+
     this->right_mtrs->move(rightMtrs);
     this->left_mtrs->move(leftMtrs);
 }
 
+void knights::Drivetrain::stop() {
+    // the limit only lets the output down by a step each command, keep sending 0 until it gets there
+    this->velocity_command(0, 0);
+    while (this->output_max_acceleration > 0 && (this->output_right_velocity != 0 || this->output_left_velocity != 0)) {
+        pros::delay(10);
+        this->velocity_command(0, 0);
+    }
+
+    this->right_mtrs->move(0);
+    this->left_mtrs->move(0);
+}
+
+bool knights::Drivetrain::limit_output(float &right_velocity, float &left_velocity) {
+    std::uint32_t now = pros::millis();
+    float dt = (now - this->output_time) / 1000.0;
+    this->output_time = now;
+
+    // nothing has been sent for a while, start from how fast the robot is actually going
+    if (dt > OUTPUT_STALE_TIME / 1000.0) {
+        this->output_right_velocity = this->right_velocity();
+        this->output_left_velocity = this->left_velocity();
+        // a motor that can't be read gives an error value instead of a velocity, take it as stopped
+        if (!std::isfinite(this->output_right_velocity))
+            this->output_right_velocity = 0;
+        if (!std::isfinite(this->output_left_velocity))
+            this->output_left_velocity = 0;
+        this->output_right_acceleration = 0;
+        this->output_left_acceleration = 0;
+        dt = OUTPUT_STALE_TIME / 1000.0;
+    }
+    if (dt <= 0)
+        return false;
+
+    float max_acceleration = this->output_max_acceleration;
+    if (this->output_max_jerk > 0) {
+        float prev_acceleration = std::fmax(fabs(this->output_right_acceleration), fabs(this->output_left_acceleration));
+        max_acceleration = std::fmin(max_acceleration, prev_acceleration + this->output_max_jerk * dt);
+    }
+    float max_change = max_acceleration * dt;
+
+    float prev_right = this->output_right_velocity, prev_left = this->output_left_velocity;
+    float right_change = right_velocity - prev_right, left_change = left_velocity - prev_left;
+    bool limited = std::fmax(fabs(right_change), fabs(left_change)) > max_change;
+
+    if (limited) {
+        // largest scale k <= 1 of the targets with each side within max_change of where it was
+        float low = 0, high = 1;
+        float targets[2] = {right_velocity, left_velocity}, prevs[2] = {prev_right, prev_left};
+        for (int i = 0; i < 2; i++) {
+            if (targets[i] == 0) {
+                if (fabs(prevs[i]) > max_change)
+                    high = -1;
+                continue;
+            }
+            float a = (prevs[i] - max_change) / targets[i], b = (prevs[i] + max_change) / targets[i];
+            low = std::fmax(low, std::fmin(a, b));
+            high = std::fmin(high, std::fmax(a, b));
+        }
+
+        if (low <= high) {
+            right_velocity *= high;
+            left_velocity *= high;
+        } else {
+            // the sides can't keep their ratio this command (ie one is reversing), step both towards the target together
+            float scale = max_change / std::fmax(fabs(right_change), fabs(left_change));
+            right_velocity = prev_right + right_change * scale;
+            left_velocity = prev_left + left_change * scale;
+        }
+    }
+
+    this->output_right_acceleration = (right_velocity - prev_right) / dt;
+    this->output_left_acceleration = (left_velocity - prev_left) / dt;
+    this->output_right_velocity = right_velocity;
+    this->output_left_velocity = left_velocity;
+    return limited;
+}
+
+void knights::Drivetrain::set_output_limits(float max_acceleration, float max_jerk) {
+    this->output_max_acceleration = max_acceleration;
+    this->output_max_jerk = max_jerk;
+    this->output_right_acceleration = 0;
+    this->output_left_acceleration = 0;
+}
+
+float knights::Drivetrain::traction_acceleration(float friction_coefficient) {
+    // the most force the tiles can push the wheels with is the friction, so a = mu * g
+    return knights::to_inches(friction_coefficient * GRAVITY);
+}
+
+void knights::Drivetrain::physical_velocity_command(float right_velocity, float left_velocity) {
+    // scale by the max velocity to get the motor command [-127, 127]
+    float scale = 127.0 / this->max_velocity();
+    this->velocity_command(knights::clamp(right_velocity * scale, -127.0f, 127.0f), knights::clamp(left_velocity * scale, -127.0f, 127.0f));
+}
+
+void knights::Drivetrain::voltage_command(float right_voltage, float left_voltage) {
+    // volts to millivolts
+    this->right_mtrs->move_voltage(knights::clamp(right_voltage, (float)-MAX_MOTOR_VOLTAGE, (float)MAX_MOTOR_VOLTAGE) * 1000);
+    this->left_mtrs->move_voltage(knights::clamp(left_voltage, (float)-MAX_MOTOR_VOLTAGE, (float)MAX_MOTOR_VOLTAGE) * 1000);
+}
+
+void knights::Drivetrain::feedforward_command(float right_velocity, float left_velocity, float right_acceleration, float left_acceleration) {
+    if (!this->has_feedforward()) {
+        this->physical_velocity_command(right_velocity, left_velocity);
+        return;
+    }
+
+    // a limited command accelerates each side as fast as the output stage let it
+    if (this->output_max_acceleration > 0 && this->limit_output(right_velocity, left_velocity)) {
+        right_acceleration = this->output_right_acceleration;
+        left_acceleration = this->output_left_acceleration;
+    }
+
+    this->voltage_command(this->right_feedforward.calculate(right_velocity, right_acceleration),
+        this->left_feedforward.calculate(left_velocity, left_acceleration));
+}
+
+void knights::Drivetrain::set_feedforward(knights::Feedforward right_feedforward, knights::Feedforward left_feedforward) {
+    this->right_feedforward = right_feedforward;
+    this->left_feedforward = left_feedforward;
+}
+
+bool knights::Drivetrain::has_feedforward() {
+    return this->right_feedforward.valid() && this->left_feedforward.valid();
+}
+
 float knights::Drivetrain::distance_to_position(float distance) {
     return distance / ((this->gear_ratio * this->wheel_diameter * M_PI) / 360);
 };
@@ -20,7 +162,8 @@ float knights::Drivetrain::position_to_distance(float position) {
 };
 
 float knights::Drivetrain::max_acceleration(float mass, float motor_amt, float stall_torque) {
-    return ((stall_torque / (this->wheel_diameter/2))*motor_amt) / mass;
+    // a = F / m, with F = torque / wheel radius (converted to meters), then converted to inches per second squared
+    return knights::to_inches(((stall_torque / knights::to_meters(this->wheel_diameter/2))*motor_amt) / mass);
 }
 
 float knights::Drivetrain::max_velocity() {
@@ -28,18 +171,173 @@ float knights::Drivetrain::max_velocity() {
     return M_PI * this->wheel_diameter * (this->rpm / 60.0);
 }
 
-knights::Holonomic::Holonomic(pros::Motor *frontRight, pros::Motor *frontLeft, pros::Motor *backRight, pros::Motor *backLeft, float track_width, float rpm, float wheel_diameter, float gear_ratio)
-    : frontRight(frontRight), frontLeft(frontLeft), backRight(backRight), backLeft(backLeft), track_width(track_width), rpm(rpm), wheel_diameter(wheel_diameter), gear_ratio(gear_ratio) {
+float knights::Drivetrain::right_velocity() {
+    // motor rpm to degrees per second, then to distance
+    return this->position_to_distance(knights::avg(this->right_mtrs->get_actual_velocity_all()) * 6);
+}
+
+float knights::Drivetrain::left_velocity() {
+    return this->position_to_distance(knights::avg(this->left_mtrs->get_actual_velocity_all()) * 6);
+}
+
+// defined here so the profile generator itself doesn't depend on PROS and can be built on a computer
+knights::ProfileGenerator::ProfileGenerator(knights::Drivetrain* drivetrain, float mass, float motor_amt, float max_lateral_acceleration) :
+    max_velocity(drivetrain->max_velocity()), max_acceleration(drivetrain->max_acceleration(mass, motor_amt)),
+    max_lateral_acceleration(max_lateral_acceleration), track_width(drivetrain->track_width) {}
+
+knights::Holonomic::Holonomic(pros::Motor *frontRight, pros::Motor *frontLeft, pros::Motor *backRight, pros::Motor *backLeft, float track_width, float rpm, float wheel_diameter, float gear_ratio,
+    holonomic_type type, float wheel_base)
+    : frontRight(frontRight), frontLeft(frontLeft), backRight(backRight), backLeft(backLeft), track_width(track_width), rpm(rpm), wheel_diameter(wheel_diameter), gear_ratio(gear_ratio),
+    kinematics(type, track_width, wheel_base) {
 }
 
 void knights::Holonomic::velocity_command(int frontRight, int frontLeft, int backRight, int backLeft) {
+    if (this->output_max_acceleration > 0) {
+        // limit in physical units, then back to the motor command [-127, 127]
+        float scale = this->max_velocity() / 127.0;
+        knights::WheelSpeeds wheels;
+        wheels.front_right = frontRight * scale;
+        wheels.front_left = frontLeft * scale;
+        wheels.back_right = backRight * scale;
+        wheels.back_left = backLeft * scale;
+        this->limit_output(wheels);
+        frontRight = std::round(wheels.front_right / scale);
+        frontLeft = std::round(wheels.front_left / scale);
+        backRight = std::round(wheels.back_right / scale);
+        backLeft = std::round(wheels.back_left / scale);
+    }
+
     this->frontRight->move(frontRight);
     this->frontLeft->move(frontLeft);
     this->backRight->move(backRight);
     this->backLeft->move(backLeft);
 }
 
+void knights::Holonomic::stop() {
+    // the limit only lets the output down by a step each command, keep sending 0 until it gets there
+    this->velocity_command(0, 0, 0, 0);
+    while (this->output_max_acceleration > 0 && this->output_wheels.max_magnitude() != 0) {
+        pros::delay(10);
+        this->velocity_command(0, 0, 0, 0);
+    }
+
+    this->frontRight->move(0);
+    this->frontLeft->move(0);
+    this->backRight->move(0);
+    this->backLeft->move(0);
+}
+
+bool knights::Holonomic::limit_output(knights::WheelSpeeds &wheels) {
+    std::uint32_t now = pros::millis();
+    float dt = (now - this->output_time) / 1000.0;
+    this->output_time = now;
+
+    // nothing has been sent for a while, start from how fast the wheels are actually going
+    if (dt > OUTPUT_STALE_TIME / 1000.0) {
+        this->output_wheels.front_right = this->wheel_velocity(this->frontRight);
+        this->output_wheels.front_left = this->wheel_velocity(this->frontLeft);
+        this->output_wheels.back_right = this->wheel_velocity(this->backRight);
+        this->output_wheels.back_left = this->wheel_velocity(this->backLeft);
+        // a motor that can't be read gives an error value instead of a velocity, take it as stopped
+        const knights::WheelSpeeds &measured = this->output_wheels;
+        if (!std::isfinite(measured.front_right + measured.front_left + measured.back_right + measured.back_left))
+            this->output_wheels = knights::WheelSpeeds();
+        this->output_acceleration = 0;
+        dt = OUTPUT_STALE_TIME / 1000.0;
+    }
+    if (dt <= 0)
+        return false;
+
+    float max_acceleration = this->output_max_acceleration;
+    if (this->output_max_jerk > 0)
+        max_acceleration = std::fmin(max_acceleration, this->output_acceleration + this->output_max_jerk * dt);
+    float max_change = max_acceleration * dt;
+
+    knights::WheelSpeeds change;
+    change.front_right = wheels.front_right - this->output_wheels.front_right;
+    change.front_left = wheels.front_left - this->output_wheels.front_left;
+    change.back_right = wheels.back_right - this->output_wheels.back_right;
+    change.back_left = wheels.back_left - this->output_wheels.back_left;
+    float largest_change = change.max_magnitude();
+    bool limited = largest_change > max_change;
+
+    if (limited) {
+        // every wheel steps towards its target by the same fraction of the way
+        float scale = max_change / largest_change;
+        wheels.front_right = this->output_wheels.front_right + change.front_right * scale;
+        wheels.front_left = this->output_wheels.front_left + change.front_left * scale;
+        wheels.back_right = this->output_wheels.back_right + change.back_right * scale;
+        wheels.back_left = this->output_wheels.back_left + change.back_left * scale;
+    }
+
+    this->output_acceleration = std::fmin(largest_change, max_change) / dt;
+    this->output_wheels = wheels;
+    return limited;
+}
+
+void knights::Holonomic::set_output_limits(float max_acceleration, float max_jerk) {
+    this->output_max_acceleration = max_acceleration;
+    this->output_max_jerk = max_jerk;
+    this->output_acceleration = 0;
+}
+
+void knights::Holonomic::set_brake_mode(pros::motor_brake_mode_e_t mode) {
+    this->frontRight->set_brake_mode(mode);
+    this->frontLeft->set_brake_mode(mode);
+    this->backRight->set_brake_mode(mode);
+    this->backLeft->set_brake_mode(mode);
+}
+
+void knights::Holonomic::move(float forward, float left, float turn) {
+    knights::WheelSpeeds wheels = knights::WheelSpeeds::mix(forward, left, turn);
+    wheels.desaturate(127.0);
+    this->velocity_command(wheels.front_right, wheels.front_left, wheels.back_right, wheels.back_left);
+}
+
+void knights::Holonomic::physical_velocity_command(knights::ChassisSpeeds speeds) {
+    knights::WheelSpeeds wheels = this->kinematics.inverse(speeds);
+    wheels.desaturate(this->max_velocity());
+
+    // scale by the max velocity to get the motor command [-127, 127]
+    float scale = 127.0 / this->max_velocity();
+    this->velocity_command(wheels.front_right * scale, wheels.front_left * scale, wheels.back_right * scale, wheels.back_left * scale);
+}
+
+void knights::Holonomic::robot_centric_drive(int vert_axis, int hori_axis, int rot_axis) {
+    // the joysticks are right positive, the robot is left and counterclockwise positive
+    this->move(vert_axis, -hori_axis, -rot_axis);
+}
+
 void knights::Holonomic::field_centric_drive(int vert_axis, int hori_axis, int rot_axis, pros::Imu* inertial) {
-    
-    // NOT IMPLEMENTED YET
+    // imu heading is clockwise in degrees, the unit circle is counterclockwise
+    float heading = knights::to_rad(-inertial->get_heading());
+    if (std::isnan(heading) || std::isinf(heading))
+        heading = 0;
+
+    // the joysticks are in the field's frame, forward along the heading the imu was reset at and x to the left of it
+    knights::ChassisSpeeds speeds = knights::ChassisSpeeds::from_field(vert_axis, -hori_axis, -rot_axis, heading);
+    this->move(speeds.forward, speeds.left, speeds.angular);
+}
+
+float knights::Holonomic::max_velocity() {
+    // v = circumfrence * rotation rate
+    return M_PI * this->wheel_diameter * (this->rpm / 60.0);
+}
+
+float knights::Holonomic::max_translation_velocity() {
+    return this->max_velocity() * this->kinematics.translation_scale();
+}
+
+float knights::Holonomic::wheel_velocity(pros::Motor *motor) {
+    // motor rpm to degrees per second, then to distance
+    return ((this->gear_ratio * this->wheel_diameter * M_PI) / 360) * motor->get_actual_velocity() * 6;
+}
+
+knights::ChassisSpeeds knights::Holonomic::get_velocity() {
+    knights::WheelSpeeds wheels;
+    wheels.front_right = this->wheel_velocity(this->frontRight);
+    wheels.front_left = this->wheel_velocity(this->frontLeft);
+    wheels.back_right = this->wheel_velocity(this->backRight);
+    wheels.back_left = this->wheel_velocity(this->backLeft);
+    return this->kinematics.forward(wheels);
 }
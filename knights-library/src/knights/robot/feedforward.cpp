@@ -0,0 +1,21 @@
+#include "knights/robot/feedforward.h"
+
+#include "knights/util/calculation.h"
+
+knights::Feedforward::Feedforward() {
+}
+
+knights::Feedforward::Feedforward(float kS, float kV, float kA)
+    : kS(kS), kV(kV), kA(kA) {
+}
+
+bool knights::Feedforward::valid() const {
+    return this->kV > 0;
+}
+
+float knights::Feedforward::calculate(float velocity, float acceleration) const {
+    // friction pushes back against the direction the robot moves, or is about to move when starting from rest
+    float direction = (velocity != 0) ? knights::signum(velocity) : knights::signum(acceleration);
+    float voltage = this->kS * direction + this->kV * velocity + this->kA * acceleration;
+    return knights::clamp(voltage, (float)-MAX_MOTOR_VOLTAGE, (float)MAX_MOTOR_VOLTAGE);
+}
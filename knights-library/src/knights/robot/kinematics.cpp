@@ -0,0 +1,63 @@
+#include "knights/robot/kinematics.h"
+
+#include <cmath>
+
+knights::ChassisSpeeds::ChassisSpeeds() {}
+
+knights::ChassisSpeeds::ChassisSpeeds(float forward, float left, float angular) : forward(forward), left(left), angular(angular) {}
+
+knights::ChassisSpeeds knights::ChassisSpeeds::from_field(float x, float y, float angular, float heading) {
+    // rotate the field velocity by the opposite of the heading
+    return ChassisSpeeds(x * cos(heading) + y * sin(heading), -x * sin(heading) + y * cos(heading), angular);
+}
+
+knights::WheelSpeeds knights::WheelSpeeds::mix(float forward, float left, float turn) {
+    WheelSpeeds wheels;
+    wheels.front_right = forward + left + turn;
+    wheels.front_left = forward - left - turn;
+    wheels.back_right = forward - left + turn;
+    wheels.back_left = forward + left - turn;
+    return wheels;
+}
+
+float knights::WheelSpeeds::max_magnitude() const {
+    return std::fmax(std::fmax(fabs(this->front_right), fabs(this->front_left)), std::fmax(fabs(this->back_right), fabs(this->back_left)));
+}
+
+void knights::WheelSpeeds::desaturate(float max) {
+    float scale = this->max_magnitude() / max;
+    if (scale <= 1)
+        return;
+
+    this->front_right /= scale;
+    this->front_left /= scale;
+    this->back_right /= scale;
+    this->back_left /= scale;
+}
+
+knights::HolonomicKinematics::HolonomicKinematics(holonomic_type type, float track_width, float wheel_base)
+    : type(type), track_width(track_width), wheel_base((wheel_base > 0) ? wheel_base : track_width) {}
+
+float knights::HolonomicKinematics::translation_scale() const {
+    return (this->type == X_DRIVE) ? M_SQRT2 : 1.0;
+}
+
+knights::WheelSpeeds knights::HolonomicKinematics::inverse(knights::ChassisSpeeds speeds) const {
+    // every wheel is half the track width and half the wheel base from the center, turning moves them by the sum of both
+    float turn_radius = (this->track_width + this->wheel_base) / 2;
+    float scale = this->translation_scale();
+
+    return WheelSpeeds::mix(speeds.forward / scale, speeds.left / scale, speeds.angular * turn_radius / scale);
+}
+
+knights::ChassisSpeeds knights::HolonomicKinematics::forward(knights::WheelSpeeds wheels) const {
+    float turn_radius = (this->track_width + this->wheel_base) / 2;
+    float scale = this->translation_scale();
+
+    // undo the mix, each wheel counts for a quarter of each motion
+    ChassisSpeeds speeds;
+    speeds.forward = scale * (wheels.front_right + wheels.front_left + wheels.back_right + wheels.back_left) / 4;
+    speeds.left = scale * (wheels.front_right - wheels.front_left - wheels.back_right + wheels.back_left) / 4;
+    speeds.angular = scale * (wheels.front_right - wheels.front_left + wheels.back_right - wheels.back_left) / (4 * turn_radius);
+    return speeds;
+}
@@ -1,5 +1,5 @@
 #include "knights/util/calculation.h"
-#include "knights/robot/drivetrain.h"
+#include "knights/util/position.h"
 
 #include <math.h>
 #include <numeric>
@@ -25,6 +25,11 @@ float knights::min_angle(float start, float target, bool rad) {
     return std::remainder(error,max);
 };
 
+float knights::unwrap_angle(float angle, float reference, bool rad) {
+    float max = rad ? M_PI*2 : 360.0;
+    return reference + std::remainder(angle - reference, max);
+};
+
 int knights::direction(float init_heading, float des_heading, bool rad) {
     float max = rad ? M_PI*2 : 360.0; 
     float diff = knights::normalize_angle(des_heading, rad) - knights::normalize_angle(init_heading, rad);
@@ -80,3 +85,30 @@ float knights::to_meters(float inches) {
 float knights::to_inches(float meters) {
     return meters*39.37;
 }
+
+float knights::circle_intersection(knights::Pos nxt, knights::Pos prev, knights::Pos curr, float lookahead_distance) {
+    knights::Pos dir = nxt - prev;
+    knights::Pos fro = prev - curr;
+
+    // get coefficents then calculate discriminant
+    float a = dir * dir;
+    float b = 2 * (fro * dir);
+    float c = (fro * fro) - lookahead_distance * lookahead_distance;
+    float discrim = b * b - 4 * a * c;
+
+    // if there are valid solutions
+    if (discrim > 0) {
+        // calculate solutions
+        discrim = sqrt(discrim);
+        float s1 = (-b + discrim) / (2 * a);
+        float s2 = (-b - discrim) / (2 * a);
+
+        if (s1 >= 0 && s1 <= 1) // if solution 1 is valid, return it
+            return s1;
+        else if (s2 >= 0 && s2 <= 1) // if solution 2 is valid, return it
+            return s2;
+        else
+            return -1;
+    } else // no or one real solution
+        return -1;
+}
@@ -0,0 +1,93 @@
+#include "knights/util/pose_history.h"
+#include "knights/util/calculation.h"
+
+knights::PoseHistory::PoseHistory(int capacity) : slots(capacity > 1 ? capacity : 2) {}
+
+void knights::PoseHistory::push(const knights::PoseSample &sample) {
+    std::uint32_t index = this->count.load(std::memory_order_relaxed);
+    Slot &slot = this->slots[index % this->slots.size()];
+
+    // odd while writing, then 2 * (index + 1) so readers can tell which sample the slot holds
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample = sample;
+    slot.sequence.store(2 * (index + 1), std::memory_order_release);
+
+    this->count.store(index + 1, std::memory_order_release);
+}
+
+void knights::PoseHistory::clear() {
+    this->count.store(0, std::memory_order_release);
+}
+
+int knights::PoseHistory::size() const {
+    std::uint32_t count = this->count.load(std::memory_order_acquire);
+    return (count < this->slots.size()) ? count : this->slots.size();
+}
+
+bool knights::PoseHistory::read(std::uint32_t index, knights::PoseSample &sample) const {
+    const Slot &slot = this->slots[index % this->slots.size()];
+
+    // never waits on the writer, a slot being rewritten only ever holds the oldest sample
+    std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before != 2 * (index + 1))
+        return false;
+
+    sample = slot.sample;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == before;
+}
+
+bool knights::PoseHistory::latest(knights::PoseSample &sample) const {
+    std::uint32_t count = this->count.load(std::memory_order_acquire);
+    return count > 0 && this->read(count - 1, sample);
+}
+
+bool knights::PoseHistory::at(std::uint32_t time, knights::PoseSample &sample) const {
+    std::uint32_t count = this->count.load(std::memory_order_acquire);
+    if (count == 0)
+        return false;
+
+    std::uint32_t newest = count - 1;
+    std::uint32_t oldest = (count > this->slots.size()) ? count - this->slots.size() : 0;
+
+    PoseSample after;
+    if (!this->read(newest, after))
+        return false;
+    if (time >= after.time) {
+        sample = after;
+        return true;
+    }
+
+    // first sample at or after the time, samples that were overwritten during the search count as too old
+    std::uint32_t low = oldest, high = newest;
+    while (low < high) {
+        std::uint32_t mid = low + (high - low) / 2;
+        PoseSample probe;
+        if (!this->read(mid, probe) || probe.time < time)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (!this->read(low, after))
+        return false;
+    if (after.time == time) {
+        sample = after;
+        return true;
+    }
+
+    PoseSample before;
+    if (low == oldest || !this->read(low - 1, before))
+        return false;
+
+    // interpolate between the two, the heading the short way around
+    float t = (float)(time - before.time) / (after.time - before.time);
+    sample.pose = Pos(before.pose.x + (after.pose.x - before.pose.x) * t, before.pose.y + (after.pose.y - before.pose.y) * t,
+        knights::normalize_angle(before.pose.heading + knights::min_angle(before.pose.heading, after.pose.heading, true) * t, true));
+    sample.velocity_x = before.velocity_x + (after.velocity_x - before.velocity_x) * t;
+    sample.velocity_y = before.velocity_y + (after.velocity_y - before.velocity_y) * t;
+    sample.angular_velocity = before.angular_velocity + (after.angular_velocity - before.angular_velocity) * t;
+    sample.time = time;
+    return true;
+}
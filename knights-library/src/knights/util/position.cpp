@@ -29,11 +29,11 @@ Point::Point() {
 }
 
 Pos knights::operator+(const Pos &pt1, const Pos &pt2) {
-    return Pos(pt1.x+pt2.x, pt1.x+pt2.x, std::fmod(pt1.heading+pt2.heading + 8*M_PI, 2*M_PI));
+    return Pos(pt1.x+pt2.x, pt1.y+pt2.y, std::fmod(pt1.heading+pt2.heading + 8*M_PI, 2*M_PI));
 };
 
 Pos knights::operator-(const Pos &pt1, const Pos &pt2) {
-    return Pos(pt1.x-pt2.x, pt1.x-pt2.x, std::fmod(pt1.heading-pt2.heading + 8*M_PI, 2*M_PI));
+    return Pos(pt1.x-pt2.x, pt1.y-pt2.y, std::fmod(pt1.heading-pt2.heading + 8*M_PI, 2*M_PI));
 };
 
 // TODO: Make sure these four below are correct logic
@@ -63,11 +63,11 @@ float knights::operator*(const Point &pt1, const Point &pt2) {
 };
 
 Point knights::operator+(const Point &pt1, const Point &pt2) {
-    return Point(pt1.x+pt2.x, pt1.x+pt2.x);
+    return Point(pt1.x+pt2.x, pt1.y+pt2.y);
 };
 
 Point knights::operator-(const Point &pt1, const Point &pt2) {
-    return Point(pt1.x-pt2.x, pt1.x-pt2.x);
+    return Point(pt1.x-pt2.x, pt1.y-pt2.y);
 };
 
 float knights::distance_btwn(const Pos &pt1, const Pos &pt2) {
@@ -1,204 +1,266 @@
-#include "calculation.h"
-#include "knights/autonomous/path.h"
-#include "knights/logger/logger.h"
+#include "knights/util/route.h"
 #include "knights/util/position.h"
-#include "knights/driver/input.h"
-#include "knights/robot/chassis.h"
-#include "knights/autonomous/pid.h"
-#include "knights/autonomous/controller.h"
+#include "knights/util/calculation.h"
 
-#include "api.h"
-
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 #include <string>
+#include <utility>
+
+knights::RouteMarker::RouteMarker(float position, bool fraction, std::string function_name) :
+    position(position), fraction(fraction), function_name(function_name) {}
+
+knights::RouteMarker::RouteMarker() {}
+
+float knights::RouteMarker::distance_along(float length) const {
+    return this->fraction ? this->position * length : this->position;
+}
 
 knights::Route::Route(std::vector<Pos> positions) {
-    this->positions = positions;
+    this->positions = std::move(positions);
+    this->compute_geometry();
 }
 
 knights::Route::Route() {
     this->positions = {};
+    this->compute_geometry();
+}
+
+void knights::Route::compute_geometry() {
+    int size = this->positions.size();
+
+    this->arc_lengths.assign(size, 0.0);
+    this->curvatures.assign(size, 0.0);
+    this->segment_lengths.assign(std::max(size - 1, 0), 0.0);
+    this->segment_directions.assign(std::max(size - 1, 0), Point());
+
+    // segment lengths, directions and the running arc length
+    for (int i = 0; i < size - 1; i++) {
+        float dx = this->positions[i+1].x - this->positions[i].x;
+        float dy = this->positions[i+1].y - this->positions[i].y;
+        float length = std::hypot(dx, dy);
+
+        this->segment_lengths[i] = length;
+        if (length > 0)
+            this->segment_directions[i] = Point(dx / length, dy / length);
+        this->arc_lengths[i+1] = this->arc_lengths[i] + length;
+    }
+
+    // curvature of the circle through each position and its neighbours, the end points are left at 0
+    for (int i = 1; i < size - 1; i++) {
+        float chord = distance_btwn(this->positions[i-1], this->positions[i+1]);
+        float denominator = this->segment_lengths[i-1] * this->segment_lengths[i] * chord;
+
+        if (denominator <= 1e-6)
+            continue;
+
+        // cross product of the two segments gives the signed area, positive when turning left
+        float cross = (this->positions[i].x - this->positions[i-1].x) * (this->positions[i+1].y - this->positions[i].y) 
+            - (this->positions[i].y - this->positions[i-1].y) * (this->positions[i+1].x - this->positions[i].x);
+
+        this->curvatures[i] = 2 * cross / denominator;
+    }
+}
+
+bool knights::Route::geometry_valid() const {
+    return this->arc_lengths.size() == this->positions.size();
 }
 
 float knights::Route::length_dist() {
     if (this->positions.size() < 2)
         return 0.0;
 
-    float dist = 0.0;
+    if (!this->geometry_valid())
+        this->compute_geometry();
 
-    for (int i = 1; i < this->positions.size(); i++) {
-        dist += distance_btwn(this->positions[i], this->positions[i-1]);
-    }
+    return this->arc_lengths.back();
+}
+
+float knights::Route::curvature_at(int i) const {
+    if (this->curvatures.empty())
+        return 0.0;
 
-    return dist;
+    return this->curvatures[knights::clamp(i, 0, (int)this->curvatures.size() - 1)];
 }
 
-knights::RouteAction::RouteAction(knights::action_type type, std::string route_name, float end_tolerance, int timeout, float lookahead) :
-    type(type), route_name(route_name), end_tolerance(end_tolerance), timeout(timeout), lookahead(lookahead) {}
+float knights::Route::curvature_at(const knights::RouteProgress &progress) const {
+    return this->curvature_at(progress.segment) * (1 - progress.t) + this->curvature_at(progress.segment + 1) * progress.t;
+}
+
+knights::RouteProgress knights::Route::project(const knights::Pos &position, const knights::RouteProgress &previous, int window) const {
+    knights::RouteProgress best = previous;
+    int segments = this->segment_lengths.size();
+
+    if (segments == 0) {
+        best.point = this->positions.empty() ? position : this->positions[0];
+        return best;
+    }
+
+    float best_dist = 1e10;
+    int last = std::min(previous.segment + window, segments - 1);
+
+    for (int i = std::max(previous.segment, 0); i <= last; i++) {
+        // project onto the segment using the cached direction, then keep it on the segment
+        float t = 0.0;
+        if (this->segment_lengths[i] > 0) {
+            float along = (position.x - this->positions[i].x) * this->segment_directions[i].x 
+                + (position.y - this->positions[i].y) * this->segment_directions[i].y;
+            t = knights::clamp(along / this->segment_lengths[i], 0.0f, 1.0f);
+        }
+
+        // don't allow moving backwards on the segment we were already on
+        if (i == previous.segment)
+            t = std::fmax(t, previous.t);
+
+        knights::Pos point = knights::lerp(this->positions[i], this->positions[i+1], t);
+        float dist = distance_btwn(position, point);
 
-knights::RouteAction::RouteAction(action_type type, float specific, float end_tolerance, int timeout) :
-    type(type), end_tolerance(end_tolerance), timeout(timeout), specific(specific) {}
+        if (dist < best_dist) {
+            best_dist = dist;
+            best.segment = i;
+            best.t = t;
+            best.point = point;
+        }
+    }
 
-knights::RouteAction::RouteAction(action_type type, std::string function_name) :
-    type(type), function_name(function_name) {}
+    best.distance = this->arc_lengths[best.segment] + this->segment_lengths[best.segment] * best.t;
 
-knights::AdvancedRoute::AdvancedRoute() {
-    this->actions = std::vector<knights::RouteAction>();
-    this->routes = std::map<std::string, Route>();
+    return best;
 }
 
-knights::AdvancedRoute::AdvancedRoute(std::map<std::string, Route> routes, std::vector<RouteAction> actions) :
-    routes(routes), actions(actions) {}
+knights::RouteProgress knights::Route::lookahead(const knights::Pos &position, float lookahead_distance, const knights::RouteProgress &start) const {
+    int segments = this->segment_lengths.size();
+
+    for (int i = std::max(start.segment, 0); i < segments; i++) {
+        float length = this->segment_lengths[i];
+        if (length <= 0)
+            continue;
+
+        // solve |from + s * direction| = lookahead for s, the distance along the segment (direction is a unit vector)
+        float from_x = this->positions[i].x - position.x;
+        float from_y = this->positions[i].y - position.y;
+        float b = from_x * this->segment_directions[i].x + from_y * this->segment_directions[i].y;
+        float c = from_x * from_x + from_y * from_y - lookahead_distance * lookahead_distance;
+        float discrim = b * b - c;
+
+        if (discrim < 0)
+            continue;
+
+        discrim = std::sqrt(discrim);
+        float min_t = (i == start.segment) ? start.t : 0.0;
+
+        // check the nearer solution first so we stop at the first forward intersection
+        for (float s : {-b - discrim, -b + discrim}) {
+            float t = s / length;
+            if (t >= min_t && t <= 1) {
+                knights::RouteProgress found;
+                found.segment = i;
+                found.t = t;
+                found.distance = this->arc_lengths[i] + length * t;
+                found.point = knights::lerp(this->positions[i], this->positions[i+1], t);
+                return found;
+            }
+        }
+    }
+
+    // no intersection, aim for the end of the route once it is inside the circle
+    if (!this->positions.empty() && segments > 0 && distance_btwn(position, this->positions.back()) <= lookahead_distance) {
+        knights::RouteProgress end;
+        end.segment = segments - 1;
+        end.t = 1.0;
+        end.distance = this->arc_lengths.back();
+        end.point = this->positions.back();
+        return end;
+    }
+
+    return start;
+}
 
 knights::Route knights::operator+(const Route &r1, const Route &r2) {
-    return Route(r1.positions + r2.positions);
+    std::vector<knights::Pos> positions = r1.positions;
+    positions.insert(positions.end(), r2.positions.begin(), r2.positions.end());
+
+    knights::Route route(positions);
+    float r1_length = r1.arc_lengths.empty() ? 0.0 : r1.arc_lengths.back();
+    float r2_length = r2.arc_lengths.empty() ? 0.0 : r2.arc_lengths.back();
+
+    // markers are kept as distances, the fractions would be of a different route now
+    route.markers = r1.markers;
+    for (knights::RouteMarker &marker : route.markers) {
+        marker.position = marker.distance_along(r1_length);
+        marker.fraction = false;
+    }
+    float gap = r1.positions.empty() || r2.positions.empty() ? 0.0 : distance_btwn(r1.positions.back(), r2.positions.front());
+    for (const knights::RouteMarker &marker : r2.markers) {
+        route.markers.emplace_back(r1_length + gap + marker.distance_along(r2_length), false, marker.function_name);
+    }
+
+    return route;
 };
 
 knights::Route knights::operator+(knights::Route r1, const knights::Pos &p1) {
     r1.positions.push_back(p1);
+    r1.compute_geometry();
     return r1;
 };
 
 knights::Route knights::operator-(knights::Route r1, const int &amt) {
     r1.positions.resize(r1.positions.size()-std::min((int)r1.positions.size(), amt));
+    r1.compute_geometry();
     return r1;
 }
 
-knights::Route knights::init_route_from_sd(std::string route_name) {
-
-    if (pros::usd::is_installed()) {
-        route_name.insert(0, "/usd/");
+knights::Route knights::resample_route(const knights::Route &route, float spacing) {
+    if (route.positions.size() < 2 || spacing <= 0)
+        return route;
 
-        std::fstream read_file(route_name, std::ios_base::in);
+    std::vector<knights::Pos> positions = {route.positions[0]};
+    float next_distance = spacing; // distance along the route of the next position to add
+    float segment_start = 0.0; // distance along the route at the start of the current segment
 
-        if (read_file) {
-            std::vector<knights::Pos> positions;
+    for (int i = 0; i < route.positions.size() - 1; i++) {
+        float length = distance_btwn(route.positions[i], route.positions[i+1]);
 
-            float x,y;
+        while (length > 0 && next_distance <= segment_start + length) {
+            positions.push_back(knights::lerp(route.positions[i], route.positions[i+1], (next_distance - segment_start) / length));
+            next_distance += spacing;
+        }
 
-            while (read_file >> x && read_file >> y) {
-                positions.emplace_back(x,y,0);
-            }
+        segment_start += length;
+    }
 
-            return knights::Route(positions);
+    // make sure the route still ends at the same position
+    if (distance_btwn(positions.back(), route.positions.back()) > spacing * 0.1)
+        positions.push_back(route.positions.back());
+    else
+        positions.back() = route.positions.back();
 
-        } else {
-            return knights::Route();
-        }
-    } else {
-        printf("SD card not found\n");
-        return knights::Route();
-    }
+    knights::Route resampled(positions);
+    resampled.markers = route.markers;
+    return resampled;
 }
 
-knights::AdvancedRoute advanced_route_from_file(std::string file_name) {
-    if (pros::usd::is_installed()) {
-        printf("Found SD card\n");
-        file_name.insert(0, "/usd/");
-
-        std::fstream read_file(file_name, std::ios_base::in);
-
-        if (read_file) {
-            std::vector<knights::RouteAction> ar_actions;
-            std::map<std::string, knights::Route> ar_routes;
-
-            std::string read_string;
-            int route_amt = 0;
-            while (read_file >> read_string) {
-                std::string identifier; float x, y, z;
-                if (read_string == "rs") { // follow route
-                    // x and y are position points in route
-                    // need to add route title
-                    read_file >> x >> y >> z;
-                    std::cout << x << y << z << "\n";
-                    float end_tol = x; int timeout = y; float lookahead = z;
-                    std::vector<knights::Pos> positions;
-                    while (identifier != "re") {
-                        read_file >> identifier;
-                        if (identifier == "p") {
-                            read_file >> x >> y;
-                            positions.emplace_back(x, y, 0);
-                        }
-                    }
-                    ar_actions.emplace_back(knights::action_type::FOLLOW, std::to_string(route_amt), end_tol, timeout, lookahead);
-                    ar_routes[std::to_string(route_amt)] = knights::Route(positions);
-                    route_amt++;
-                }
-                else if (read_string == "ps") { // move for distance
-                    // x = distance, y = end_tolerance, z = timeout
-                    read_file >> x >> y >> z;
-
-                    knights::RouteAction new_action(knights::action_type::LATERAL, x, y, z);
-
-                    ar_actions.push_back(new_action);
-
-                    knights::logger::red(knights::logger::string_format("lateral: %lf %lf %lf", 
-                        x, y, z));
-                    // printf("lateral: %lf %lf %d\n", 
-                    //         new_action.specific, new_action.end_tolerance, new_action.timeout);
-                }
-                else if (read_string == "ts") { // turn to angle
-                    // x = angle, y = end_tolerance, z = timeout
-                    read_file >> x >> y >> z;
-                    ar_actions.emplace_back(knights::action_type::TURN, x, y, z);
-                }
-                else if (read_string == "cs") { // command start
-                    // logic for commands here
-                    read_file >> identifier;
-                    ar_actions.emplace_back(knights::action_type::COMMAND, identifier);
-                }
-                else if (read_string == "eof")
-                    break;
-	        }
-
-            return knights::AdvancedRoute(ar_routes, ar_actions);
-
-        } else {
-            return knights::AdvancedRoute();
-        }
-    } else {
-        printf("SD card not found\n");
-        return knights::AdvancedRoute();
-    }
-}
+knights::Route knights::smooth_route(const knights::Route &route, float weight_data, float weight_smooth, float tolerance) {
+    std::vector<knights::Pos> smoothed = route.positions;
+    float change = tolerance;
 
-void knights::AdvancedRoute::execute(knights::RobotChassis *chassis, knights::PIDController *lateral_pid, knights::PIDController *turn_pid, knights::input::AutonomousInputMap *input_map) {
-    
-    knights::RamseteConstants ramsete_constants(1, 0.5);
+    // gradient descent, each pass pulls positions towards their original spot and towards their neighbours
+    for (int pass = 0; change >= tolerance && pass < 1000; pass++) {
+        change = 0.0;
 
-    knights::RobotController lateralController(chassis, lateral_pid, &ramsete_constants, false);
-    knights::RobotController turnController(chassis, turn_pid, &ramsete_constants, false);
+        for (int i = 1; i < (int)smoothed.size() - 1; i++) {
+            float prev_x = smoothed[i].x, prev_y = smoothed[i].y;
 
-    for (RouteAction curr_action : this->actions) {
-        if (curr_action.type == knights::action_type::LATERAL) {
-            lateralController.lateral_move(curr_action.specific, curr_action.end_tolerance, curr_action.timeout);
-            knights::logger::red(knights::logger::string_format("lateral %lf", curr_action.specific));
-        }
-        else if (curr_action.type == knights::action_type::TURN) {
-            turnController.turn_to_angle(curr_action.specific, 0,curr_action.end_tolerance, curr_action.timeout, true);
-            knights::logger::green(knights::logger::string_format("turn %lf", curr_action.specific));
-        }
-        else if (curr_action.type == knights::action_type::FOLLOW && this->routes.contains(curr_action.route_name)) {
-            lateralController.follow_route_pursuit(
-                this->routes[curr_action.route_name], 
-                curr_action.lookahead, 
-                lateral_pid->get_max_speed(), 
-                knights::signum(curr_action.lookahead),
-                curr_action.end_tolerance, 
-                curr_action.timeout
-            );
-            knights::logger::cyan(knights::logger::string_format("follow: %s , pos: %lf %lf %lf , error: %lf", curr_action.route_name.c_str(), 
-                chassis->get_position().x, chassis->get_position().y, chassis->get_position().heading, 
-                knights::distance_btwn(chassis->get_position(), this->routes[curr_action.route_name].positions.back())));
-            // for (knights::Pos pos : this->routes[curr_action.route_name].positions) {
-            //     // knights::logger::yellow(knights::logger::string_format("p: %lf %lf %lf", pos.x, pos.y, pos.heading));
-            // }
-        }
-        else if (curr_action.type == knights::action_type::COMMAND) {
-            input_map->execute_action(curr_action.function_name);
-            knights::logger::blue(knights::logger::string_format("command %s", curr_action.function_name.c_str()));
-            pros::delay(400);
+            smoothed[i].x += weight_data * (route.positions[i].x - smoothed[i].x) 
+                + weight_smooth * (smoothed[i-1].x + smoothed[i+1].x - 2 * smoothed[i].x);
+            smoothed[i].y += weight_data * (route.positions[i].y - smoothed[i].y) 
+                + weight_smooth * (smoothed[i-1].y + smoothed[i+1].y - 2 * smoothed[i].y);
+
+            change += std::fabs(prev_x - smoothed[i].x) + std::fabs(prev_y - smoothed[i].y);
         }
-        pros::delay(200);
     }
-}
\ No newline at end of file
+
+    knights::Route smoothed_route(smoothed);
+    smoothed_route.markers = route.markers;
+    return smoothed_route;
+}
@@ -43,8 +43,6 @@ knights::RobotChassis chassis(
 	&odomTrackers
 );
 
-pros::Task *odomTask = nullptr;
-
 /**
  * Runs initialization code. This occurs as soon as the program is started.
  *
@@ -133,29 +131,9 @@ void autonomous() {
 	midOdom.reset();
 	backOdom.reset();
 
-	// run odometry loop
-	if (odomTask == nullptr)
-		pros::Task *odomTask = new pros::Task {[=] {
-			while (true) {
-				chassis.update_position(); // query odometry system for position
-				
-				// input everything to a string
-				std::stringstream stream;
-				stream << "Curr Pos: ";
-				stream << std::fixed << std::setprecision(2) << chassis.get_position().x << " ";
-				stream << std::fixed << std::setprecision(2) << chassis.get_position().y << " ";
-				stream << std::fixed << std::setprecision(2) << knights::to_deg(chassis.get_position().heading);
-				std::string s = stream.str();
-
-				// Set the display label to the current position
-				knights::display::set_pos_label(s);
-
-				// Move the current position dot to the desired position
-				knights::display::change_curr_pos_dot(chassis.get_position());
-
-				pros::delay(10);
-			}
-		}};
+	// run odometry on its own task at a fixed period, and show the position on the display at a low rate
+	chassis.start_odometry();
+	knights::display::start_position_display(&chassis);
 
 	// Run the chosen auton
 	auton_map[package.type + std::to_string(package.number)](&chassis);
@@ -255,30 +233,9 @@ void opcontrol() {
 	midOdom.reset();
 	backOdom.reset();
 
-	// run odometry loop
-	if (odomTask == nullptr)
-		pros::Task *odomTask = new pros::Task {[=] {
-			while (true) {
-				chassis.update_position(); // query odometry system for position
-				
-				// Convoluted method of inputting everything to a string
-				std::stringstream stream;
-				stream << "Curr Pos: ";
-				stream << std::fixed << std::setprecision(2) << chassis.get_position().x << " ";
-				stream << std::fixed << std::setprecision(2) << chassis.get_position().y << " ";
-				stream << std::fixed << std::setprecision(2) << knights::to_deg(chassis.get_position().heading);
-				std::string s = stream.str();
-				// printf("curr pos: %lf %lf %lf\n", chassis.get_position().x, chassis.get_position().y, chassis.get_position().heading);
-
-				// Set the display label to the current position
-				knights::display::set_pos_label(s);
-
-				// Move the current position dot to the desired position
-				knights::display::change_curr_pos_dot(chassis.get_position());
-
-				pros::delay(10);
-			}
-		}};
+	// run odometry on its own task at a fixed period, and show the position on the display at a low rate
+	chassis.start_odometry();
+	knights::display::start_position_display(&chassis);
 
 	float right_velocity = 0; float left_velocity = 0; 
 
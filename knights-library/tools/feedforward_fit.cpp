@@ -0,0 +1,186 @@
+// Host tool that fits the drivetrain feedforward model to a characterization log.
+//
+// Drivetrain::characterize() writes the voltage sent to each side and the velocity measured on it during
+// quasistatic and dynamic tests. This reads that file, estimates the acceleration from the velocity, and fits
+// V = kS * sign(v) + kV * v + kA * a to each side with least squares.
+//
+// Build and run from the knights-library folder:
+//   g++ -std=c++20 -O2 -Iinclude -o feedforward_fit tools/feedforward_fit.cpp
+//   ./feedforward_fit characterization.csv
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Sample {
+    std::string test;
+    float time; // milliseconds since the test started
+    float voltage[2]; // right, left, in volts
+    float velocity[2]; // right, left, in inches per second
+};
+
+struct Fit {
+    double kS = 0, kV = 0, kA = 0;
+    double r_squared = 0;
+    int used = 0;
+    bool valid = false;
+};
+
+void print_usage() {
+    printf("usage: feedforward_fit <characterization.csv> [options]\n");
+    printf("  --min-velocity <in/s>      samples slower than this are left out, the robot isn't moving yet (default 0.5)\n");
+    printf("  --window <samples>         samples on each side used to estimate the acceleration (default 2)\n");
+}
+
+// solve a 3x3 system with gaussian elimination and partial pivoting
+bool solve3(double m[3][4], double out[3]) {
+    for (int col = 0; col < 3; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < 3; row++)
+            if (std::fabs(m[row][col]) > std::fabs(m[pivot][col]))
+                pivot = row;
+        if (std::fabs(m[pivot][col]) < 1e-12)
+            return false;
+        for (int k = 0; k < 4; k++)
+            std::swap(m[col][k], m[pivot][k]);
+
+        for (int row = 0; row < 3; row++) {
+            if (row == col)
+                continue;
+            double factor = m[row][col] / m[col][col];
+            for (int k = col; k < 4; k++)
+                m[row][k] -= factor * m[col][k];
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+        out[i] = m[i][3] / m[i][i];
+    return true;
+}
+
+Fit fit_side(const std::vector<Sample> &samples, int side, float min_velocity, int window) {
+    // normal equations of least squares, x = [sign(v), v, a], y = voltage
+    double normal[3][4] = {};
+    std::vector<double> xs[3], ys;
+
+    for (int i = 0; i < samples.size(); i++) {
+        // acceleration from the velocity a few samples on each side, only inside the same test
+        int before = i - window, after = i + window;
+        if (before < 0 || after >= samples.size() || samples[before].test != samples[i].test || samples[after].test != samples[i].test)
+            continue;
+
+        float v = samples[i].velocity[side];
+        if (std::fabs(v) < min_velocity)
+            continue;
+
+        float seconds = (samples[after].time - samples[before].time) / 1000;
+        if (seconds <= 0)
+            continue;
+        float a = (samples[after].velocity[side] - samples[before].velocity[side]) / seconds;
+
+        double x[3] = {(v > 0) ? 1.0 : -1.0, v, a};
+        double y = samples[i].voltage[side];
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++)
+                normal[r][c] += x[r] * x[c];
+            normal[r][3] += x[r] * y;
+            xs[r].push_back(x[r]);
+        }
+        ys.push_back(y);
+    }
+
+    Fit fit;
+    fit.used = ys.size();
+
+    double k[3];
+    if (fit.used < 3 || !solve3(normal, k))
+        return fit;
+
+    fit.kS = k[0]; fit.kV = k[1]; fit.kA = k[2];
+    fit.valid = true;
+
+    // how much of the voltage the model explains
+    double mean = 0;
+    for (double y : ys)
+        mean += y;
+    mean /= ys.size();
+
+    double residual = 0, total = 0;
+    for (int i = 0; i < ys.size(); i++) {
+        double predicted = fit.kS * xs[0][i] + fit.kV * xs[1][i] + fit.kA * xs[2][i];
+        residual += (ys[i] - predicted) * (ys[i] - predicted);
+        total += (ys[i] - mean) * (ys[i] - mean);
+    }
+    fit.r_squared = (total > 0) ? 1 - residual / total : 0;
+
+    return fit;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    float min_velocity = 0.5;
+    int window = 2;
+
+    for (int i = 2; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--min-velocity") && has_value)
+            min_velocity = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--window") && has_value)
+            window = std::max(1, atoi(argv[++i]));
+        else {
+            printf("unknown option %s\n", argv[i]);
+            print_usage();
+            return 1;
+        }
+    }
+
+    std::ifstream input(argv[1]);
+    if (!input) {
+        printf("couldn't open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<Sample> samples;
+    std::string line;
+    std::getline(input, line); // header
+
+    while (std::getline(input, line)) {
+        for (char &c : line)
+            if (c == ',')
+                c = ' ';
+
+        std::istringstream fields(line);
+        Sample sample;
+        if (fields >> sample.test >> sample.time >> sample.voltage[0] >> sample.voltage[1] >> sample.velocity[0] >> sample.velocity[1])
+            samples.push_back(sample);
+    }
+
+    printf("%zu samples\n", samples.size());
+
+    const char *side_names[] = {"right", "left"};
+    Fit fits[2];
+    for (int side = 0; side < 2; side++) {
+        fits[side] = fit_side(samples, side, min_velocity, window);
+        if (!fits[side].valid) {
+            printf("%s: not enough moving samples to fit\n", side_names[side]);
+            return 1;
+        }
+        printf("%-6s kS %.4f V, kV %.5f V/(in/s), kA %.5f V/(in/s^2), r^2 %.4f (%d samples)\n", side_names[side],
+            fits[side].kS, fits[side].kV, fits[side].kA, fits[side].r_squared, fits[side].used);
+    }
+
+    printf("\ndrivetrain.set_feedforward(knights::Feedforward(%.4f, %.5f, %.5f), knights::Feedforward(%.4f, %.5f, %.5f));\n",
+        fits[0].kS, fits[0].kV, fits[0].kA, fits[1].kS, fits[1].kV, fits[1].kA);
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+// Host simulation of the Monte Carlo localizer with synthetic odometry and distance sensor readings.
+//
+// Drives a simulated robot around the field, gives the localizer odometry that drifts like tracking wheels
+// with a wrong diameter and an IMU with a bias, and distance readings ray cast against the same map with
+// noise and dropouts. Prints how far dead reckoning and the localizer end up from the true pose, and how long
+// an update takes for a few particle counts to size it to the brain.
+//
+// Build and run from the knights-library folder:
+//   g++ -std=c++20 -O2 -Iinclude -o localization_sim tools/localization_sim.cpp
+//       src/knights/autonomous/localization.cpp src/knights/util/position.cpp src/knights/util/calculation.cpp
+//   ./localization_sim [--particles <amount>] [--seed <seed>]
+
+#include "knights/autonomous/localization.h"
+#include "knights/util/calculation.h"
+#include "knights/util/position.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define STEP 0.05 // time between localizer updates, in seconds
+#define DURATION 30.0 // length of the simulated run, in seconds
+#define ODOMETRY_SCALE 1.015 // tracking wheels read this much further than the robot moved
+#define HEADING_DRIFT 0.004 // IMU heading drift, in radians per second
+
+struct Result {
+    float dead_reckoning_error = 0;
+    float localizer_error = 0, localizer_max_error = 0;
+    float heading_error = 0;
+};
+
+// field walls and a goal in the middle, like a match field with something the sensors see
+knights::FieldMap field_map() {
+    knights::FieldMap map = knights::FieldMap::perimeter();
+    map.add_box(60.2, 60.2, 80.2, 80.2);
+    return map;
+}
+
+// sensors facing each side of the robot
+std::vector<knights::BeamSensor> robot_sensors() {
+    return {
+        knights::BeamSensor(6, 0, 0),
+        knights::BeamSensor(-6, 0, M_PI),
+        knights::BeamSensor(0, 6, M_PI / 2),
+        knights::BeamSensor(0, -6, -M_PI / 2),
+    };
+}
+
+// figure eight around the goal, the true pose at a time
+knights::Pos true_pose(float time) {
+    float t = time * 0.35;
+    float x = 70.2 + 45 * sin(t);
+    float y = 70.2 + 30 * sin(2 * t);
+    float dx = 45 * cos(t), dy = 60 * cos(2 * t);
+    return knights::Pos(x, y, knights::normalize_angle(atan2(dy, dx), true));
+}
+
+Result simulate(int particles, std::uint32_t seed) {
+    knights::FieldMap map = field_map();
+    std::vector<knights::BeamSensor> sensors = robot_sensors();
+    knights::MonteCarloLocalizer localizer(&map, sensors, particles, knights::LocalizerNoise(), seed);
+
+    std::mt19937 random(seed + 1);
+    std::normal_distribution<float> reading_noise(0, 1);
+    std::uniform_real_distribution<float> chance(0, 1);
+
+    knights::Pos truth = true_pose(0);
+    knights::Pos odometry = truth;
+    localizer.initialize(truth, 1.0, 0.02);
+
+    Result result;
+    int steps = 0;
+    float total_error = 0;
+    for (float time = STEP; time <= DURATION; time += STEP) {
+        knights::Pos next = true_pose(time);
+
+        // odometry moves by the true change relative to the robot, scaled wrong, with a drifting heading
+        float delta_x = next.x - truth.x, delta_y = next.y - truth.y;
+        float forward = (delta_x * cos(truth.heading) + delta_y * sin(truth.heading)) * ODOMETRY_SCALE;
+        float lateral = (-delta_x * sin(truth.heading) + delta_y * cos(truth.heading)) * ODOMETRY_SCALE;
+        float turn = knights::min_angle(truth.heading, next.heading, true) + HEADING_DRIFT * STEP;
+
+        knights::Pos previous_odometry = odometry;
+        float average_heading = odometry.heading + turn / 2;
+        odometry.x += forward * cos(average_heading) - lateral * sin(average_heading);
+        odometry.y += forward * sin(average_heading) + lateral * cos(average_heading);
+        odometry.heading = knights::normalize_angle(odometry.heading + turn, true);
+        truth = next;
+
+        localizer.predict(previous_odometry, odometry);
+
+        // what each sensor sees from the true pose, sometimes nothing and sometimes another robot
+        std::vector<float> readings;
+        for (const knights::BeamSensor &sensor : sensors) {
+            float x = truth.x + sensor.forward * cos(truth.heading) - sensor.left * sin(truth.heading);
+            float y = truth.y + sensor.forward * sin(truth.heading) + sensor.left * cos(truth.heading);
+            float distance = map.ray_cast(x, y, truth.heading + sensor.angle, 1000);
+            float roll = chance(random);
+
+            if (distance > sensor.max_range || roll < 0.05)
+                distance = -1;
+            else if (roll < 0.1)
+                distance *= chance(random);
+            else
+                distance += reading_noise(random) * (0.4 + 0.03 * distance);
+            readings.push_back(distance);
+        }
+        localizer.update(readings.data());
+
+        knights::Pos estimate = localizer.get_estimate();
+        float error = knights::distance_btwn(estimate, truth);
+        total_error += error;
+        result.localizer_max_error = std::fmax(result.localizer_max_error, error);
+        steps++;
+    }
+
+    knights::Pos estimate = localizer.get_estimate();
+    result.dead_reckoning_error = knights::distance_btwn(odometry, truth);
+    result.localizer_error = total_error / steps;
+    result.heading_error = fabsf(knights::min_angle(estimate.heading, truth.heading, true));
+    return result;
+}
+
+// microseconds for one predict and update with four readings
+double time_update(int particles) {
+    knights::FieldMap map = field_map();
+    std::vector<knights::BeamSensor> sensors = robot_sensors();
+    knights::MonteCarloLocalizer localizer(&map, sensors, particles);
+    knights::Pos pose(30, 30, 0.5);
+    localizer.initialize(pose, 2.0, 0.05);
+    float readings[4] = {40, 25, 35, 28};
+
+    int runs = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        knights::Pos next(pose.x + 0.2, pose.y, pose.heading);
+        localizer.predict(pose, next);
+        localizer.update(readings);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / runs;
+}
+
+void print_usage() {
+    printf("usage: localization_sim [options]\n");
+    printf("  --particles <amount>   particles used in the simulated run (default %d)\n", MCL_PARTICLES);
+    printf("  --seed <seed>          seed of the sensor noise and the localizer (default 1)\n");
+}
+
+int main(int argc, char **argv) {
+    int particles = MCL_PARTICLES;
+    std::uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+            particles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = atoi(argv[++i]);
+        else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    Result result = simulate(particles, seed);
+    printf("%.0f second run, %d particles\n", DURATION, particles);
+    printf("  dead reckoning final error: %.2f in\n", result.dead_reckoning_error);
+    printf("  localizer average error:    %.2f in (max %.2f in)\n", result.localizer_error, result.localizer_max_error);
+    printf("  localizer heading error:    %.2f deg\n", knights::to_deg(result.heading_error));
+
+    printf("update time on this computer, 4 sensors, %d wall segments\n", field_map().size());
+    for (int amount : {100, 300, 1000, 3000})
+        printf("  %5d particles: %8.1f us\n", amount, time_update(amount));
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Host micro-benchmark for the pure pursuit closest point and lookahead searches.
+//
+// Compares the full scan the follower used to do every loop (nearest position from the last closest
+// index to the end of the route, then circle_intersection on every remaining segment) against
+// Route::project() and Route::lookahead(), which resume from last loop's progress.
+//
+// Build and run from the knights-library folder:
+//   g++ -std=c++20 -O2 -Iinclude -o lookahead_bench tools/lookahead_bench.cpp
+//       src/knights/util/route.cpp src/knights/util/position.cpp src/knights/util/calculation.cpp
+//   ./lookahead_bench
+
+#include "knights/util/route.h"
+#include "knights/util/position.h"
+#include "knights/util/calculation.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#define LOOKAHEAD 15.0
+
+// back and forth route across the field with a point every inch, like the ones the path writer exports
+knights::Route serpentine_route(int point_amt) {
+    std::vector<knights::Pos> positions;
+    float x = -60, y = -60, dir = 1;
+
+    for (int i = 0; i < point_amt; i++) {
+        positions.emplace_back(x, y, 0);
+        x += dir;
+        if (std::fabs(x) > 60) {
+            // turn around in a half circle with a 6 inch radius
+            for (int j = 1; j < 19 && i < point_amt - 1; j++, i++) {
+                float angle = -M_PI_2 + j * M_PI / 18;
+                positions.emplace_back(x + dir * 6 * std::cos(angle), y + 6 + 6 * std::sin(angle), 0);
+            }
+            y += 12;
+            dir = -dir;
+            x += dir;
+        }
+    }
+
+    return knights::Route(positions);
+}
+
+// the search the follower did before the progress tracking, kept here as the baseline
+knights::Pos full_scan(const knights::Route &route, const knights::Pos &curr, int &closest_i, knights::Pos target) {
+    float closest_dist = 1e5;
+    for (int i = closest_i; i < route.positions.size(); i++) {
+        float dist = knights::distance_btwn(curr, route.positions[i]);
+        if (dist < closest_dist) {
+            closest_dist = dist;
+            closest_i = i;
+        }
+    }
+
+    for (int i = closest_i; i < route.positions.size() - 1; i++) {
+        float t = knights::circle_intersection(route.positions[i+1], route.positions[i], curr, LOOKAHEAD);
+        if (t != -1)
+            target = knights::lerp(route.positions[i], route.positions[i+1], t);
+    }
+
+    return target;
+}
+
+int main() {
+    printf("%8s %8s %14s %14s %10s %14s\n", "points", "loops", "scan ns/loop", "track ns/loop", "speedup", "jumped");
+
+    for (int point_amt : {200, 500, 1000, 2000, 5000}) {
+        knights::Route route = serpentine_route(point_amt);
+
+        // robot positions slightly off the route, one loop per half inch of travel
+        std::vector<knights::Pos> robot_positions;
+        for (int i = 0; i < route.positions.size() - 1; i++) {
+            for (float t : {0.0f, 0.5f}) {
+                knights::Pos pos = knights::lerp(route.positions[i], route.positions[i+1], t);
+                pos.x += 0.5 * std::sin(i * 0.1);
+                pos.y += 0.5 * std::cos(i * 0.1);
+                robot_positions.push_back(pos);
+            }
+        }
+
+        float checksum = 0;
+
+        auto scan_start = std::chrono::steady_clock::now();
+        int closest_i = 0;
+        knights::Pos scan_target = route.positions[0];
+        std::vector<knights::Pos> scan_targets;
+        for (const knights::Pos &pos : robot_positions) {
+            scan_target = full_scan(route, pos, closest_i, scan_target);
+            scan_targets.push_back(scan_target);
+        }
+        auto scan_end = std::chrono::steady_clock::now();
+
+        auto track_start = std::chrono::steady_clock::now();
+        knights::RouteProgress progress, lookahead_progress;
+        std::vector<knights::Pos> track_targets;
+        for (const knights::Pos &pos : robot_positions) {
+            progress = route.project(pos, progress);
+
+            knights::RouteProgress search_start = progress;
+            if (lookahead_progress.distance > progress.distance && knights::distance_btwn(pos, lookahead_progress.point) <= LOOKAHEAD)
+                search_start = lookahead_progress;
+
+            lookahead_progress = route.lookahead(pos, LOOKAHEAD, search_start);
+            track_targets.push_back(lookahead_progress.point);
+        }
+        auto track_end = std::chrono::steady_clock::now();
+
+        // count loops where the full scan kept a later hit on another part of the route (like the next row)
+        int far_targets = 0;
+        for (int i = 0; i < robot_positions.size(); i++) {
+            checksum += scan_targets[i].x + track_targets[i].x;
+            if (knights::distance_btwn(scan_targets[i], track_targets[i]) > 1)
+                far_targets++;
+        }
+
+        double scan_ns = std::chrono::duration<double, std::nano>(scan_end - scan_start).count() / robot_positions.size();
+        double track_ns = std::chrono::duration<double, std::nano>(track_end - track_start).count() / robot_positions.size();
+
+        printf("%8d %8zu %14.1f %14.1f %9.1fx %14d   (checksum %.1f)\n", (int)route.positions.size(), robot_positions.size(),
+            scan_ns, track_ns, scan_ns / track_ns, far_targets, checksum);
+    }
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Host route compiler, turns an advanced route text file from the path planner into a compiled route.
+//
+// Every follow route is resampled to evenly spaced positions, smoothed, and has its curvature and a
+// time parameterized velocity profile computed here. The brain then only has to load the file with
+// compiled_route_from_file() and track the trajectories, instead of doing this at the start of autonomous.
+// A route chained into the next action with "ch" ends at that exit velocity, and a route after a chained
+// motion starts at its exit velocity.
+// With --raw the text file is only converted, routes are kept as drawn and no trajectories are generated.
+//
+// Build and run from the knights-library folder:
+//   g++ -std=c++20 -O2 -Iinclude -o route_compiler tools/route_compiler.cpp
+//       src/knights/autonomous/path.cpp src/knights/autonomous/movements/profile.cpp
+//       src/knights/util/route.cpp src/knights/util/position.cpp src/knights/util/calculation.cpp
+//   ./route_compiler skills.txt skills.krc --max-velocity 76.6 --max-acceleration 150 --track-width 16
+
+#include "knights/autonomous/path.h"
+#include "knights/autonomous/profile.h"
+#include "knights/util/route.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+void print_usage() {
+    printf("usage: route_compiler <input.txt> <output.krc> [options]\n");
+    printf("  --spacing <in>                   distance between resampled positions (default 1.0)\n");
+    printf("  --smooth <data> <smooth>         smoothing weights, 0 0 to turn off (default 0.25 0.75)\n");
+    printf("  --max-velocity <in/s>            fastest the robot can drive (default 76.6)\n");
+    printf("  --max-acceleration <in/s^2>      fastest the robot can speed up or slow down (default 150)\n");
+    printf("  --max-lateral-acceleration <in/s^2>  fastest the robot can accelerate sideways (default 120)\n");
+    printf("  --track-width <in>               width from the right wheels to the left wheels (default 16)\n");
+    printf("  --interval <ms>                  time between trajectory timestamps (default 10)\n");
+    printf("  --raw                            only convert the text file, no resampling, smoothing or trajectories\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        print_usage();
+        return 1;
+    }
+
+    std::string input_name = argv[1];
+    std::string output_name = argv[2];
+
+    float spacing = 1.0;
+    float weight_data = 0.25, weight_smooth = 0.75;
+    float max_velocity = 76.6, max_acceleration = 150.0, max_lateral_acceleration = 120.0;
+    float track_width = 16.0;
+    float interval = 10.0;
+    bool raw = false;
+
+    for (int i = 3; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--spacing") && has_value)
+            spacing = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--smooth") && i + 2 < argc) {
+            weight_data = atof(argv[++i]);
+            weight_smooth = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--max-velocity") && has_value)
+            max_velocity = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--max-acceleration") && has_value)
+            max_acceleration = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--max-lateral-acceleration") && has_value)
+            max_lateral_acceleration = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--track-width") && has_value)
+            track_width = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--interval") && has_value)
+            interval = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--raw"))
+            raw = true;
+        else {
+            printf("unknown option %s\n", argv[i]);
+            print_usage();
+            return 1;
+        }
+    }
+
+    std::ifstream input(input_name);
+    if (!input) {
+        printf("couldn't open %s\n", input_name.c_str());
+        return 1;
+    }
+
+    knights::AdvancedRoute route = knights::parse_advanced_route(input);
+    knights::ProfileGenerator generator(max_velocity, max_acceleration, max_lateral_acceleration, track_width);
+
+    printf("%zu actions, %zu follow routes\n", route.actions.size(), route.routes.size());
+
+    route.profiles.resize(route.routes.size());
+    for (int i = 0; i < route.routes.size(); i++) {
+        knights::Route &curr_route = route.routes[i];
+
+        if (raw) {
+            printf("  route %d: %zu positions, %.1f in\n", i, curr_route.positions.size(), curr_route.length_dist());
+            continue;
+        }
+
+        int original_size = curr_route.positions.size();
+
+        curr_route = knights::resample_route(curr_route, spacing);
+        if (weight_smooth > 0)
+            curr_route = knights::smooth_route(curr_route, weight_data, weight_smooth);
+
+        // start and end at the velocities carried in from and out to the actions around the route
+        float start_velocity = 0.0, end_velocity = 0.0;
+        for (int j = 0; j < route.actions.size(); j++) {
+            const knights::RouteAction &action = route.actions[j];
+            if (action.type != knights::action_type::FOLLOW || action.route_index != i)
+                continue;
+            start_velocity = route.entry_velocity(j);
+            if (action.next_start == knights::start_condition::IMMEDIATE)
+                end_velocity = action.exit_velocity;
+            break;
+        }
+
+        route.profiles[i] = generator.generate_profile(curr_route, interval, start_velocity, end_velocity);
+
+        const std::vector<knights::ProfileTimestamp> &profile = route.profiles[i];
+        printf("  route %d: %d -> %zu positions, %.1f in, %.2f s\n", i, original_size, curr_route.positions.size(),
+            curr_route.length_dist(), profile.empty() ? 0.0 : profile.back().time / 1000.0);
+    }
+
+    std::ofstream output(output_name, std::ios_base::binary);
+    if (!output || !knights::write_compiled_route(output, route)) {
+        printf("couldn't write %s\n", output_name.c_str());
+        return 1;
+    }
+
+    printf("wrote %s (%ld bytes)\n", output_name.c_str(), (long)output.tellp());
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Host benchmark for loading advanced routes.
+//
+// Makes a skills route file with 2000 positions in the path planner's text format, then times the
+// stream >> std::string parser the library used to have (kept here as the baseline), the block
+// tokenizer in parse_advanced_route(), and read_compiled_route() on the same route converted to
+// the compiled format. Both text parsers are checked to give the same route.
+//
+// Build and run from the knights-library folder:
+//   g++ -std=c++20 -O2 -Iinclude -o route_load_bench tools/route_load_bench.cpp
+//       src/knights/autonomous/path.cpp src/knights/autonomous/movements/profile.cpp
+//       src/knights/util/route.cpp src/knights/util/position.cpp src/knights/util/calculation.cpp
+//   ./route_load_bench
+
+#include "knights/autonomous/path.h"
+#include "knights/util/route.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define POINT_AMT 2000
+#define ROUTE_AMT 20
+#define RUNS 50
+
+// text file like the ones the path planner exports, follow routes with moves, turns and commands in between
+std::string skills_file() {
+    std::string file;
+    char line[64];
+
+    for (int i = 0; i < ROUTE_AMT; i++) {
+        file += "rs 2.0 5000 15.0\n";
+        for (int j = 0; j < POINT_AMT / ROUTE_AMT; j++) {
+            float t = i * (POINT_AMT / ROUTE_AMT) + j;
+            snprintf(line, sizeof(line), "p %.4f %.4f\n", 60 * std::sin(t * 0.01), 60 * std::cos(t * 0.013));
+            file += line;
+        }
+        file += "re\n";
+        file += "ps 12.5 0.5 1000\nts 90.0 0.05 1000\ncs intakeFwd\n";
+    }
+
+    file += "eof\n";
+    return file;
+}
+
+// the parser before the tokenizer, routes keyed by strings in a map
+struct LegacyRoute {
+    std::map<std::string, knights::Route> routes;
+    std::vector<knights::RouteAction> actions;
+};
+
+LegacyRoute legacy_parse(std::istream &stream) {
+    LegacyRoute out;
+
+    std::string read_string;
+    int route_amt = 0;
+    while (stream >> read_string) {
+        std::string identifier; float x, y, z;
+        if (read_string == "rs") {
+            stream >> x >> y >> z;
+            float end_tol = x; int timeout = y; float lookahead = z;
+            std::vector<knights::Pos> positions;
+            while (identifier != "re" && stream >> identifier) {
+                if (identifier == "p") {
+                    stream >> x >> y;
+                    positions.emplace_back(x, y, 0);
+                }
+            }
+            out.actions.emplace_back(knights::action_type::FOLLOW, route_amt, end_tol, timeout, lookahead);
+            out.routes[std::to_string(route_amt)] = knights::Route(positions);
+            route_amt++;
+        }
+        else if (read_string == "ps") {
+            stream >> x >> y >> z;
+            out.actions.emplace_back(knights::action_type::LATERAL, x, y, z);
+        }
+        else if (read_string == "ts") {
+            stream >> x >> y >> z;
+            out.actions.emplace_back(knights::action_type::TURN, x, y, z);
+        }
+        else if (read_string == "cs") {
+            stream >> identifier;
+            out.actions.emplace_back(knights::action_type::COMMAND, identifier);
+        }
+        else if (read_string == "eof")
+            break;
+    }
+
+    return out;
+}
+
+template <typename F>
+double time_us(F function) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RUNS; i++)
+        function();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / RUNS;
+}
+
+int main() {
+    std::string text = skills_file();
+
+    std::istringstream legacy_stream(text), stream(text);
+    LegacyRoute legacy = legacy_parse(legacy_stream);
+    knights::AdvancedRoute route = knights::parse_advanced_route(stream);
+
+    // make sure both parsers read the same thing
+    bool same = legacy.actions.size() == route.actions.size() && legacy.routes.size() == route.routes.size();
+    for (int i = 0; same && i < route.routes.size(); i++) {
+        const std::vector<knights::Pos> &a = legacy.routes[std::to_string(i)].positions, &b = route.routes[i].positions;
+        same = a.size() == b.size();
+        for (int j = 0; same && j < a.size(); j++)
+            same = a[j].x == b[j].x && a[j].y == b[j].y;
+    }
+    for (int i = 0; same && i < route.actions.size(); i++) {
+        same = legacy.actions[i].type == route.actions[i].type && legacy.actions[i].specific == route.actions[i].specific
+            && legacy.actions[i].timeout == route.actions[i].timeout && legacy.actions[i].function_name == route.actions[i].function_name;
+    }
+
+    std::ostringstream compiled_stream;
+    knights::write_compiled_route(compiled_stream, route);
+    std::string compiled = compiled_stream.str();
+
+    size_t count = 0;
+    double legacy_us = time_us([&]() {
+        std::istringstream s(text);
+        count += legacy_parse(s).actions.size();
+    });
+    double parse_us = time_us([&]() {
+        std::istringstream s(text);
+        count += knights::parse_advanced_route(s).actions.size();
+    });
+    double compiled_us = time_us([&]() {
+        count += knights::read_compiled_route(compiled.data(), compiled.size()).actions.size();
+    });
+
+    printf("%d positions, %zu actions, text %zu bytes, compiled %zu bytes, parsers match: %s\n", POINT_AMT, route.actions.size(),
+        text.size(), compiled.size(), same ? "yes" : "NO");
+    printf("%-28s %10.1f us\n", "stream >> string (before)", legacy_us);
+    printf("%-28s %10.1f us  %5.1fx\n", "block tokenizer", parse_us, legacy_us / parse_us);
+    printf("%-28s %10.1f us  %5.1fx\n", "compiled", compiled_us, legacy_us / compiled_us);
+    printf("(checksum %zu actions parsed)\n", count);
+
+    return same ? 0 : 1;
+}
@@ -14,7 +14,7 @@ use file::{dump_route, read_route, write_to_file};
 use menu::create_app_menu;
 use num::ToPrimitive;
 use tauri::{Manager, State};
-use util::{dist_between, Movement};
+use util::{dist_between, Marker, Movement};
 
 struct CurrPos(Mutex<[f64; 3]>);
 struct CtrlPointList(Mutex<Vec<Movement>>);
@@ -476,6 +476,46 @@ fn add_command(name: String, state_mvmt_list: State<CtrlPointList>, state_curr_p
     return redraw(mvmt_list.to_vec()); // redraw frontend
 }
 
+#[tauri::command]
+fn add_marker(position: String, name: String, id: i32, state_mvmt_list: State<CtrlPointList>) -> ((Vec<i32>, Vec<i32>), (Vec<i32>, Vec<i32>), Vec<Movement>) {
+    // unwrap state
+    let mut mvmt_list = state_mvmt_list.0.lock().unwrap();
+
+    // "30" is 30 inches along the route, "95%" is 95% of the way along it
+    let position = position.trim();
+    let (value, fraction) = match position.strip_suffix('%') {
+        Some(percent) => (percent.trim().parse::<f64>().map(|p| p / 100.0), true),
+        None => (position.parse::<f64>(), false),
+    };
+
+    // the route file is split on whitespace, so the name can't have any
+    let name = name.replace('"', "").split_whitespace().collect::<Vec<&str>>().join("_");
+
+    if let Ok(value) = value {
+        for mvmt in mvmt_list.iter_mut() {
+            if mvmt.id == id && mvmt.ctrl.len() > 2 && name.len() > 0 { // only follow movements have markers
+                mvmt.markers.push(Marker { position: value, fraction: fraction, name: name.clone() });
+            }
+        }
+    }
+
+    return redraw(mvmt_list.to_vec()); // redraw frontend
+}
+
+#[tauri::command]
+fn clear_markers(id: i32, state_mvmt_list: State<CtrlPointList>) -> ((Vec<i32>, Vec<i32>), (Vec<i32>, Vec<i32>), Vec<Movement>) {
+    // unwrap state
+    let mut mvmt_list = state_mvmt_list.0.lock().unwrap();
+
+    for mvmt in mvmt_list.iter_mut() {
+        if mvmt.id == id {
+            mvmt.markers.clear();
+        }
+    }
+
+    return redraw(mvmt_list.to_vec()); // redraw frontend
+}
+
 #[tauri::command]
 fn clear(state_mvmt_list: State<CtrlPointList>, state_curr_pos: State<CurrPos>, state_curr_id: State<StateId>, state_start_pos: State<StartPos>) -> ((Vec<i32>, Vec<i32>), (Vec<i32>, Vec<i32>), Vec<Movement>) {
     // unwrap state
@@ -561,6 +601,14 @@ fn export_file(path: String, state_mvmt_list: State<CtrlPointList>) {
                     println!("Error generating Bezier curve: {}", e);
                 }
             }
+            for marker in mvmt_list[j].markers.iter() { // markers, as inches or a percent of the route
+                let marker_string: String = if marker.fraction {
+                    format!("m {}% {}\n", marker.position * 100.0, marker.name)
+                } else {
+                    format!("m {} {}\n", marker.position, marker.name)
+                };
+                print_string.push_str(&marker_string);
+            }
             let start_string: &str = "re\n"; // end follow route
             print_string.push_str(start_string); // add to write string
         }
@@ -656,7 +704,7 @@ fn main() {
         .invoke_handler(tauri::generate_handler![
             click, select_ctrl, move_ctrl, deselect_ctrl, export_file, add_lateral_movement, 
             add_turn_movement, add_command, delete_last, change_mvmt, clear, save_file, load_file,
-            change_start_pos, export_movement
+            change_start_pos, export_movement, add_marker, clear_markers
         ])
         .run(tauri::generate_context!())
         .expect("error while running tauri application");
@@ -75,6 +75,13 @@ pub fn bezier_curve(points: &[(f64, f64, f64)], n_times: usize) -> Result<(Array
     Ok((xvals, yvals))
 }
 
+#[derive(PartialEq, Clone, Debug, Default, Serialize, Deserialize)]
+pub struct Marker {
+    pub position: f64, // inches along the route, or a fraction of the route
+    pub fraction: bool,
+    pub name: String, // command to run
+}
+
 #[derive(PartialEq, Clone, Debug, Default, Serialize, Deserialize)]
 pub struct Movement {
     pub ctrl: Vec<(f64, f64, f64)>,
@@ -85,6 +92,8 @@ pub struct Movement {
     pub lookahead: f64,
     pub name: String,
     pub id: i32,
+    #[serde(default)]
+    pub markers: Vec<Marker>,
 }
 
 impl Movement {
@@ -97,7 +106,8 @@ impl Movement {
             timeout: timeout,
             lookahead: lookahead,
             name: name,
-            id: id
+            id: id,
+            markers: Vec::new()
         }
     }
 
@@ -107,6 +117,14 @@ impl Movement {
             JsonValue::Array(vec![JsonValue::from(*x), JsonValue::from(*y), JsonValue::from(*z)])
         }).collect();
 
+        let markers_json: Vec<JsonValue> = self.markers.iter().map(|marker| {
+            object! {
+                "position" => marker.position,
+                "fraction" => marker.fraction,
+                "name" => marker.name.clone(),
+            }
+        }).collect();
+
         object! {
             "ctrl" => points_json,
             "distance" => self.distance,
@@ -116,6 +134,7 @@ impl Movement {
             "lookahead" => self.lookahead,
             "name" => self.name.clone(),
             "id" => self.id,
+            "markers" => markers_json,
         }
     }
 
@@ -158,6 +177,18 @@ impl Movement {
         let id = json["id"].as_i32()
             .ok_or("Missing or invalid id")?;
 
+        // routes saved before markers were added don't have any
+        let markers = match &json["markers"] {
+            JsonValue::Array(arr) => arr.iter()
+                .map(|item| Ok(Marker {
+                    position: item["position"].as_f64().ok_or("Missing or invalid marker position")?,
+                    fraction: item["fraction"].as_bool().ok_or("Missing or invalid marker fraction")?,
+                    name: item["name"].as_str().ok_or("Missing or invalid marker name")?.to_string(),
+                }))
+                .collect::<Result<Vec<Marker>, String>>()?,
+            _ => Vec::new(),
+        };
+
         Ok(Movement {
             ctrl,
             distance,
@@ -167,6 +198,7 @@ impl Movement {
             lookahead,
             name,
             id,
+            markers,
         })
     }
 
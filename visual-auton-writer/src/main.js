@@ -126,10 +126,32 @@ function addMovementList(movementList) {
 
       selected_mvmt = movementList[i].id;
 
+      updateMarkersTitle(movementList[i]);
+
       console.log("selected mvmt ", selected_mvmt);
     })
 
     container.appendChild(item);
+
+    // keep the marker count of the selected movement up to date
+    if (movementList[i].id == selected_mvmt) {
+      updateMarkersTitle(movementList[i]);
+    }
+  }
+}
+
+function updateMarkersTitle(movement) {
+  const markersTitle = document.getElementById("markers-title");
+
+  if (movement.ctrl.length <= 2) {
+    markersTitle.innerText = "Markers: follow only";
+  }
+  else if (movement.markers.length == 0) {
+    markersTitle.innerText = "Markers: none";
+  }
+  else {
+    markersTitle.innerText = "Markers: " + movement.markers.map((marker) => 
+      (marker.fraction ? Math.round(marker.position * 1000) / 10 + "%" : marker.position) + " " + marker.name).join(", ");
   }
 }
 
@@ -326,6 +348,31 @@ async function updateSelectedRoute(e) {
   }
 }
 
+async function addMarker(e) {
+  const markerPosition = document.getElementById("marker-position");
+  const markerName = document.getElementById("marker-name");
+
+  if (markerPosition.value != "" && markerName.value != "" && selected_mvmt != -1) {
+    const locations = await invoke("add_marker", {position: markerPosition.value, name: markerName.value, id: selected_mvmt});
+    const [[xVals, yVals],[ctrlXVals, ctrlYVals],movementList] = locations;
+
+    addMovementList(movementList);
+
+    addPointsToHTML(xVals, yVals, ctrlXVals, ctrlYVals);
+  }
+}
+
+async function clearMarkers(e) {
+  if (selected_mvmt != -1) {
+    const locations = await invoke("clear_markers", {id: selected_mvmt});
+    const [[xVals, yVals],[ctrlXVals, ctrlYVals],movementList] = locations;
+
+    addMovementList(movementList);
+
+    addPointsToHTML(xVals, yVals, ctrlXVals, ctrlYVals);
+  }
+}
+
 async function savePath(e) {
   var selectedPath = await saveFile()
 
@@ -442,6 +489,20 @@ window.addEventListener("DOMContentLoaded", () => {
     return false;
   })
 
+  document.getElementById("edit-markers").addEventListener('submit', (e) =>{
+    e.preventDefault();
+
+    addMarker(e);
+
+    return false;
+  })
+
+  document.getElementById("marker-clear").addEventListener("mousedown", (e) => {
+    e.preventDefault();
+
+    clearMarkers(e);
+  })
+
   document.getElementById("edit-start-pos").addEventListener('submit', (e) =>{
     e.preventDefault();
 